@@ -0,0 +1,331 @@
+﻿#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "../TetrisSDL/SquareMatrixData.h"
+#include "../TetrisSDL/RenderTarget.h"
+#include "../TetrisSDL/Map.h"
+#include "../TetrisSDL/Blocks.h"
+#include "../TetrisSDL/Game.h"
+#include "../TetrisSDL/TetrisSetup.h"
+#include "../TetrisSDL/SpectatorStream.h"
+
+//Microbenchmarks for Map, Blocks and the renderers.
+//Rendering goes to an offscreen RenderTarget, once through SDL_FillRect and once
+//through the software SDL_Renderer. Results are printed as JSON
+//(to the file given as first argument, or to stdout).
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+    double bytesPerOp = 0;//output size of codecs, left out of the JSON when 0
+};
+
+std::vector<BenchResult> results;
+volatile int benchSink = 0;
+
+//doubles the iterations count until one run takes at least minSeconds
+template<typename F>
+void bench(const std::string& name, F body, double minSeconds = 0.2) {
+    uint64_t iterations = 1;
+    double seconds;
+    for (;;) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (uint64_t k = 0; k < iterations; k++)body();
+        seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        if (seconds >= minSeconds || iterations >= (1ull << 32))break;
+        iterations *= 2;
+    }
+    results.push_back(BenchResult{ name, iterations, seconds * 1e9 / iterations });
+    std::cerr << name << ": " << results.back().nsPerOp << " ns/op\n";
+}
+
+//stack of `height` rows with one hole per row, the lowest `fullRows` rows without holes
+void fillStack(Map& obj, int height, int fullRows) {
+    for (int y = 0, x; y < obj.mapSizeY(); y++)for (x = 0; x < obj.mapSizeX(); x++)obj.setCell(y, x, ' ');
+    for (int k = 0, y = obj.mapSizeY() - 1; k < height; k++, y--) {
+        for (int x = 0; x < obj.mapSizeX(); x++)obj.setCell(y, x, (k < fullRows || x != (k * 3) % obj.mapSizeX()) ? 'p' : ' ');
+    }
+    obj.highestPoint = obj.mapSizeY() - height;
+}
+
+void writeJson(std::ostream& out, SDL_Surface* surface) {
+    out << "{\n  \"surface\": { \"w\": " << surface->w << ", \"h\": " << surface->h
+        << ", \"bpp\": " << (int)surface->format->BitsPerPixel << " },\n  \"benchmarks\": [\n";
+    for (size_t k = 0; k < results.size(); k++) {
+        out << "    { \"name\": \"" << results[k].name << "\", \"iterations\": " << results[k].iterations
+            << ", \"ns_per_op\": " << results[k].nsPerOp;
+        if (results[k].bytesPerOp > 0)out << ", \"bytes_per_op\": " << results[k].bytesPerOp;
+        out << " }" << ((k + 1 < results.size()) ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int SDL_main(int argc, char* argv[])
+{
+    //same layout as the game window in TetrisSDL.cpp
+    SquareMatrixData renderDataMap(
+        20, 10,
+        0, 0,
+        8, 8,
+        0x141414, 0xC8C8C8,
+        25,
+        2, 2
+    );
+    SquareMatrixData blocksPool(
+        16, 4,
+        0, renderDataMap.getMatrixFieldSizeX(),
+        100, 6,
+        0xC8C8C8,
+        0x141414,
+        21,
+        1, 1,
+        true
+    );
+    SquareMatrixData renderDataNums(
+        65, renderDataMap.getMatrixFieldSizeX() + 100,
+        renderDataMap.getMatrixFieldSizeY(), 0,
+        5, 20,
+        0x5A5A5A, 0xC8C8C8,
+        11,
+        0, 0,
+        false
+    );
+
+    RenderTarget offscreen;
+    if (!offscreen.createSurface(renderDataMap.getMatrixFieldSizeX() + 100, renderDataMap.getMatrixFieldSizeY() + 65)) {
+        std::cerr << "SDL_CreateRGBSurface: " << SDL_GetError() << "\n";
+        return(1);
+    }
+
+    //rules engine, no rendering
+    Map logicMap(20, 10);
+    setupMapSymbols(logicMap);
+    Blocks logicBlocks(logicMap);
+    setupBlocks(logicBlocks);
+
+    char* field = new char[logicMap.mapSizeY() * logicMap.mapSizeX()];
+    auto tBlock = logicBlocks[4];
+
+    fillStack(logicMap, 14, 0);
+    int column = 0;
+    bench("Map::canChange/tall_stack", [&]() {
+        benchSink += logicMap.canChange(4, column, tBlock->sizeY, tBlock->sizeX, tBlock->arr);
+        column = (column + 1) % (logicMap.mapSizeX() - tBlock->sizeX + 1);
+    });
+
+    fillStack(logicMap, 0, 0);
+    bench("Map::changeMap/place_remove", [&]() {
+        logicMap.changeMap(10, 4, tBlock->sizeY, tBlock->sizeX, tBlock->arr);
+        logicMap.changeMap(10, 4, tBlock->sizeY, tBlock->sizeX, tBlock->arr, 0);
+    });
+
+    //checkStreak runs on a restored board, Map::loadField is measured separately to subtract it
+    bench("Map::loadField", [&]() {
+        logicMap.loadField(field);
+    });
+    for (int height = 4; height <= 16; height += 12) {
+        for (int lines = 0; lines <= 4; lines++) {
+            fillStack(logicMap, height, lines);
+            logicMap.saveField(field);
+            bench("Map::checkStreak/stack_" + std::to_string(height) + "/lines_" + std::to_string(lines), [&]() {
+                logicMap.loadField(field);
+                logicMap.highestPoint = logicMap.mapSizeY() - height;
+                benchSink += logicMap.checkStreak();
+            });
+        }
+    }
+    //garbage rows move the stack as row pointers, on the same restored board as checkStreak
+    for (int rows = 1; rows <= 4; rows += 3) {
+        fillStack(logicMap, 8, 0);
+        logicMap.saveField(field);
+        bench("Map::insertGarbage/stack_8/rows_" + std::to_string(rows), [&]() {
+            logicMap.loadField(field);
+            logicMap.highestPoint = logicMap.mapSizeY() - 8;
+            benchSink += logicMap.insertGarbage(rows, 3);
+        });
+    }
+
+    fillStack(logicMap, 0, 0);
+    logicBlocks.pickBlock(tBlock);
+    logicMap.changeMap(logicBlocks.fallingBlockPosY + 8, logicBlocks.fallingBlockPosX, tBlock->sizeY, tBlock->sizeX, tBlock->arr);
+    logicBlocks.fallingBlockPosY += 8;
+    bench("Blocks::changeForm", [&]() {
+        logicBlocks.changeForm();
+    });
+
+    //checkpoint and clone cost of the whole game state
+    Game logicGame(logicBlocks, logicMap, renderDataNums);
+    GameState state;
+    logicBlocks.resetBlocks();
+    fillStack(logicMap, 8, 0);
+    logicBlocks.pickBlock(tBlock);
+    logicBlocks.updateGhost();
+    logicMap.changeMap(logicBlocks.fallingBlockPosY, logicBlocks.fallingBlockPosX, tBlock->sizeY, tBlock->sizeX, tBlock->arr);
+    std::cerr << "GameState: " << sizeof(GameState) << " bytes\n";
+    bench("Game::snapshot", [&]() {
+        benchSink += logicGame.snapshot(state, 0);
+    });
+    bench("Game::restore", [&]() {
+        benchSink += logicGame.restore(state, 0);
+    });
+    //saveGame is what the game loop pays, writeSave what the writer thread pays per save
+    SaveWriter saveWriter;
+    if (saveWriter.start("bench_save.dat")) {
+        logicGame.saves = &saveWriter;
+        bench("Game::saveGame", [&]() {
+            logicGame.saveGame();
+        });
+        logicGame.saves = nullptr;
+        saveWriter.stop();
+    }
+    bench("writeSave", [&]() {
+        benchSink += writeSave("bench_save.dat", state);
+    });
+    remove("bench_save.dat");
+
+    //versus: one fixed step with random buttons, and what a rollback of one game over 8 frames costs
+    Uint32 buttonsState = 7;
+    int stepFrame = 0;
+    auto nextButtons = [&]() {
+        buttonsState ^= buttonsState << 13;
+        buttonsState ^= buttonsState >> 17;
+        buttonsState ^= buttonsState << 5;
+        return (Uint8)((buttonsState & (buttonLeft | buttonRight | buttonRotate)) | ((buttonsState % 40 == 0) ? buttonDrop : 0));
+    };
+    logicGame.resetGame();
+    bench("Game::stepFrame", [&]() {
+        if (logicGame.getGameOver())logicGame.resetGame();
+        logicGame.stepFrame(nextButtons(), (double)(stepFrame++) * 16);
+    });
+    logicGame.resetGame();
+    for (stepFrame = 0; stepFrame < 100; stepFrame++)logicGame.stepFrame(nextButtons(), (double)stepFrame * 16);
+    logicGame.snapshot(state, (double)stepFrame * 16);
+    bench("Game::rollback/8_frames", [&]() {
+        logicGame.restore(state, (double)stepFrame * 16);
+        for (int k = 0; k < 8; k++)logicGame.stepFrame((k & 1) ? buttonLeft : 0, (double)(stepFrame + k) * 16);
+    });
+
+    //spectator stream: the states of 4096 frames of random play, encoded in a loop. Bytes per frame count
+    //every simulated frame (unchanged ones cost nothing) against the full board a frame used to cost.
+    const int streamFrames = 4096;
+    std::vector<GameState> streamStates(streamFrames);
+    logicGame.resetGame();
+    for (int k = 0; k < streamFrames; k++) {
+        if (logicGame.getGameOver())logicGame.resetGame();
+        logicGame.stepFrame(nextButtons(), (double)k * 16);
+        memset(&streamStates[k], 0, sizeof(GameState));
+        logicGame.snapshot(streamStates[k], (double)k * 16);
+    }
+    Uint8 streamFrame[SpectatorEncoder::maxFrameSize];
+    SpectatorEncoder encoder;
+    uint64_t streamBytes = 0;
+    for (int k = 0; k < streamFrames; k++)streamBytes += encoder.encode(streamStates[k], streamFrame);
+    std::cerr << "spectator stream: " << (double)streamBytes / streamFrames << " bytes/frame, FrameSnapshot "
+        << sizeof(FrameSnapshot) << " bytes/frame\n";
+    int streamIndex = 0;
+    bench("SpectatorEncoder::encode", [&]() {
+        benchSink += encoder.encode(streamStates[streamIndex++ & (streamFrames - 1)], streamFrame);
+    });
+    results.back().bytesPerOp = (double)streamBytes / streamFrames;
+    int keyframeSize = encoder.encodeKeyframe(streamFrame);
+    bench("SpectatorEncoder::encode/keyframe", [&]() {
+        benchSink += encoder.encode(streamStates[streamIndex++ & (streamFrames - 1)], streamFrame, true);
+    });
+    results.back().bytesPerOp = keyframeSize;
+    SpectatorDecoder decoder;
+    bench("SpectatorDecoder::decode/keyframe", [&]() {
+        benchSink += decoder.decode(streamFrame + 2, keyframeSize - 2);
+    });
+
+    //solid fill of one square: SDL_FillRect against fillRects32 with every row writer the CPU has,
+    //RenderTarget::kernelMaxWidth should sit where SDL_FillRect starts winning
+    std::vector<FillRowFunc> rowFuncs{ fillRowScalar };
+#ifdef FILL_KERNEL_X86
+    if (SDL_HasSSE2())rowFuncs.push_back(fillRowSSE2);
+    if (SDL_HasAVX2())rowFuncs.push_back(fillRowAVX2);
+#endif
+    std::cerr << "fill kernel dispatch: " << fillRowName(fillRow()) << "\n";
+    int fillSizes[6]{ 11, 21, 25, 64, 256, 0 };
+    for (int size : fillSizes) {
+        SDL_Rect rect{ 1, 1, size, size };
+        std::string suffix = "/" + std::to_string(size);
+        if (size == 0) {
+            rect = SDL_Rect{ 0, 0, offscreen.surface->w, offscreen.surface->h };
+            suffix = "/full_surface";
+        }
+        bench("fill/SDL_FillRect" + suffix, [&]() {
+            SDL_FillRect(offscreen.surface, &rect, 0x5A5A5A);
+        });
+        for (FillRowFunc func : rowFuncs) {
+            bench(std::string("fill/") + fillRowName(func) + suffix, [&]() {
+                fillRects32(offscreen.surface, &rect, 1, 0x5A5A5A, func);
+            });
+        }
+    }
+
+    //renderers
+    Map renderMap(20, 10);
+    renderMap.mapMatrix = &renderDataMap;
+    setupMapSymbols(renderMap);
+
+    Blocks renderBlocks(renderMap);
+    renderBlocks.blocksMatrix = &blocksPool;
+    setupBlocks(renderBlocks);
+    for (int k = 0; k < renderBlocks.blocksPoolSize; k++)renderBlocks.blocksPool[k] = renderBlocks[k % renderBlocks.countOfBlocks];
+
+    Game renderGame(renderBlocks, renderMap, renderDataNums);
+
+    //both backends draw the same frames, names are suffixed with the backend
+    RenderTarget softwareRenderer;
+    if (!softwareRenderer.createSoftwareRenderer(offscreen.surface->w, offscreen.surface->h)) {
+        std::cerr << "SDL_CreateSoftwareRenderer: " << SDL_GetError() << "\n";
+        return(1);
+    }
+    RenderTarget* targets[2]{ &offscreen, &softwareRenderer };
+    const char* backendNames[2]{ "surface", "renderer" };
+
+    for (int b = 0; b < 2; b++) {
+        std::string backend = std::string("/") + backendNames[b];
+        renderMap.target = renderBlocks.target = renderGame.target = targets[b];
+
+        fillStack(renderMap, 10, 0);
+        bench("Map::renderField/full" + backend, [&]() {
+            renderMap.renderField(0);
+        });
+
+        renderBlocks.pickBlock(renderBlocks[4]);
+        renderMap.changeMap(renderBlocks.fallingBlockPosY, renderBlocks.fallingBlockPosX, renderBlocks.fallingBlock->sizeY, renderBlocks.fallingBlock->sizeX, renderBlocks.fallingBlock->arr);
+        int shift = 1;
+        bench("Map::renderField/incremental_move" + backend, [&]() {
+            renderBlocks.moveBlock(renderBlocks.fallingBlockPosY, renderBlocks.fallingBlockPosX + shift);
+            shift = -shift;
+        });
+
+        renderGame.renderNums(0);
+        int score = 0;
+        bench("Game::renderNums/update" + backend, [&]() {
+            score = (score + 176) % 10000000;
+            renderGame.setScore(score);
+            renderGame.renderNums(1);
+        });
+        bench("Game::renderNums/full" + backend, [&]() {
+            renderGame.renderNums(0);
+        });
+
+        bench("Blocks::renderBlockStrick" + backend, [&]() {
+            renderBlocks.renderBlockStrick();
+        });
+    }
+
+    if (argc > 1) {
+        std::ofstream out(argv[1]);
+        writeJson(out, offscreen.surface);
+    }
+    else writeJson(std::cout, offscreen.surface);
+
+    delete[] field;
+    return(0);
+}
@@ -0,0 +1,130 @@
+﻿#include <iostream>
+#include <string>
+#include <SDL.h>
+#include "../TetrisSDL/Map.h"
+#include "../TetrisSDL/Blocks.h"
+#include "../TetrisSDL/TetrisSetup.h"
+
+//Perft for the rules engine: counts every placement sequence of a seeded blocks queue
+//on fixed start boards. Blocks are dropped straight down in every form and column,
+//so the numbers only change when canChange/changeMap/checkStreak change behaviour.
+
+struct PerftBoard {
+    const char* name;
+    int garbageRows;//rows filled from the bottom, one hole per row
+};
+
+//own generator instead of rand(), so queues are the same on every platform
+uint32_t perftRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void fillBoard(Map& obj, int garbageRows, uint32_t seed) {
+    uint32_t state = seed * 2654435761u + 1;
+    for (int y = 0, x; y < obj.mapSizeY(); y++)for (x = 0; x < obj.mapSizeX(); x++)obj.setCell(y, x, ' ');
+
+    for (int y = obj.mapSizeY() - 1, hole; y >= obj.mapSizeY() - garbageRows; y--) {
+        hole = perftRandom(state) % obj.mapSizeX();
+        for (int x = 0; x < obj.mapSizeX(); x++)if (x != hole)obj.setCell(y, x, 'p');
+    }
+    obj.highestPoint = obj.mapSizeY() - garbageRows;
+}
+
+//same rule as Game::startGame: no block twice in a row
+void fillQueue(int* queue, int length, int countOfBlocks, uint32_t seed) {
+    uint32_t state = seed * 2654435761u + 1;
+    for (int k = 0, prevBlock = -1, blockNum; k < length; k++) {
+        do {
+            blockNum = perftRandom(state) % countOfBlocks;
+        } while (prevBlock == blockNum);
+        queue[k] = prevBlock = blockNum;
+    }
+}
+
+//`fields` is a stack of one board per remaining depth, the top one keeps this node's board
+uint64_t perft(Map& obj, Blocks& blocks, const int* queue, int depth, uint64_t& placements, char* fields) {
+    if (depth == 0)return 1;
+
+    uint64_t nodes = 0;
+    char* field = fields;
+    int highestPoint = obj.highestPoint;
+    obj.saveField(field);
+
+    auto block = blocks[queue[0]], form = block;
+    do {
+        for (int x = 0, y; x + form->sizeX <= obj.mapSizeX(); x++) {
+            if (!obj.canChange(0, x, form->sizeY, form->sizeX, form->arr))continue;
+            for (y = 0; obj.canChange(y + 1, x, form->sizeY, form->sizeX, form->arr); y++);
+
+            obj.changeMap(y, x, form->sizeY, form->sizeX, form->arr);
+            if (obj.highestPoint > y)obj.highestPoint = y;
+            obj.checkStreak();
+            placements++;
+
+            nodes += perft(obj, blocks, queue + 1, depth - 1, placements, fields + obj.mapSizeY() * obj.mapSizeX());
+
+            obj.loadField(field);
+            obj.highestPoint = highestPoint;
+        }
+        form = form->nextForm;
+    } while (form != nullptr && form != block);
+
+    return(nodes);
+}
+
+int SDL_main(int argc, char* argv[])
+{
+    int depth = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t seeds[3]{ 1, 2, 3 };
+    int seedsCount = 3;
+    if (argc > 2) {
+        seeds[0] = std::stoul(argv[2]);
+        seedsCount = 1;
+    }
+
+    PerftBoard boards[3]{
+        { "empty", 0 },
+        { "garbage", 4 },
+        { "tall", 14 }
+    };
+
+    Map perftMap(20, 10);
+    setupMapSymbols(perftMap);
+
+    Blocks perftBlocks(perftMap);
+    setupBlocks(perftBlocks);
+
+    int* queue = new int[depth + 1];
+    char* fields = new char[depth * perftMap.mapSizeY() * perftMap.mapSizeX()];
+    uint64_t totalPlacements = 0, nodes, placements;
+    double totalSeconds = 0, seconds;
+    Uint64 start;
+
+    for (int s = 0; s < seedsCount; s++) {
+        fillQueue(queue, depth + 1, perftBlocks.countOfBlocks, seeds[s]);
+        for (int b = 0; b < 3; b++) {
+            fillBoard(perftMap, boards[b].garbageRows, seeds[s]);
+            placements = 0;
+
+            start = SDL_GetPerformanceCounter();
+            nodes = perft(perftMap, perftBlocks, queue, depth, placements, fields);
+            seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+            totalPlacements += placements;
+            totalSeconds += seconds;
+            std::cout << "seed " << seeds[s] << " board " << boards[b].name << " depth " << depth
+                << ": nodes " << nodes << ", placements " << placements
+                << ", " << (uint64_t)(placements / seconds) << " placements/s\n";
+        }
+    }
+
+    std::cout << "total: placements " << totalPlacements << ", " << totalSeconds << " s, "
+        << (uint64_t)(totalPlacements / totalSeconds) << " placements/s\n";
+
+    delete[] fields;
+    delete[] queue;
+    return(0);
+}
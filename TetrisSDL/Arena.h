@@ -0,0 +1,108 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <SDL.h>
+
+//Bump allocator for everything a game session allocates once: map rows, block forms,
+//rect tables, score arrays. Nothing is freed one by one; memory comes in chunks the destructor
+//returns all at once, so objects made from it must not outlive the arena. Games restart and
+//servers recycle sessions in place instead of allocating again.
+//Destructors of allocated objects never run, so only trivially destructible types go here;
+//containers (Map's color tables) stay on the heap.
+class Arena {
+    struct Chunk {
+        Chunk* next;
+        size_t size;
+    };
+    Chunk* current = nullptr;//newest chunk, the others follow through next
+    size_t used = 0;//bytes used in current
+    size_t chunkSize;
+    //statistics for report
+    size_t bytesUsed = 0, bytesReserved = 0, allocations = 0, chunks = 0;
+public:
+    Arena(size_t chunkSize = 16384) :chunkSize(chunkSize) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+    template<typename T>
+    T* allocArray(size_t count);
+    size_t getBytesUsed() { return bytesUsed; }
+    void report(const char* name);
+
+    ~Arena();
+};
+
+inline void* Arena::allocate(size_t size, size_t align) {
+    for (;;) {
+        if (this->current != nullptr) {
+            uintptr_t data = (uintptr_t)(this->current + 1);
+            uintptr_t position = (data + this->used + align - 1) & ~(uintptr_t)(align - 1);
+            if (position + size <= data + this->current->size) {
+                this->bytesUsed += position + size - (data + this->used);
+                this->used = position + size - data;
+                this->allocations++;
+                return (void*)position;
+            }
+        }
+
+        size_t chunkBytes = (size + align > this->chunkSize) ? size + align : this->chunkSize;
+        Chunk* chunk = (Chunk*)::operator new(sizeof(Chunk) + chunkBytes);
+        chunk->size = chunkBytes;
+        chunk->next = this->current;
+        this->current = chunk;
+        this->used = 0;
+        this->bytesReserved += chunkBytes;
+        this->chunks++;
+    }
+}
+
+//value-initialized array (zeroed for plain types)
+template<typename T>
+inline T* Arena::allocArray(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value, "arena never runs destructors");
+    T* items = (T*)allocate(sizeof(T) * (count ? count : 1), alignof(T));
+    for (size_t k = 0; k < count; k++)new (&items[k]) T();
+    return items;
+}
+
+inline void Arena::report(const char* name) {
+    SDL_Log("%s: %u bytes in %u allocations, %u bytes reserved in %u chunks", name,
+        (unsigned)this->bytesUsed, (unsigned)this->allocations, (unsigned)this->bytesReserved, (unsigned)this->chunks);
+}
+
+inline Arena::~Arena() {
+    for (Chunk* chunk = this->current, *next; chunk != nullptr; chunk = next) {
+        next = chunk->next;
+        ::operator delete(chunk);
+    }
+}
+
+//arena the game objects made on this thread allocate from; without one they fall back to new[]
+//(tools, benchmarks). Per thread, so server workers build their sessions in their own arenas.
+inline Arena*& sessionArena() {
+    static thread_local Arena* arena = nullptr;
+    return arena;
+}
+
+template<typename T>
+inline T* arenaArray(size_t count) {
+    if (sessionArena() == nullptr)return new T[count]();
+    return sessionArena()->allocArray<T>(count);
+}
+
+template<typename T, typename... Args>
+inline T* arenaNew(Args&&... args) {
+    static_assert(std::is_trivially_destructible<T>::value, "arena never runs destructors");
+    if (sessionArena() == nullptr)return new T(std::forward<Args>(args)...);
+    return new (sessionArena()->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+//frees arrays from arenaArray made while `owner` was the session arena; arena ones go with the arena
+template<typename T>
+inline void arenaFree(T* items, Arena* owner) {
+    if (owner == nullptr)delete[] items;
+}
@@ -0,0 +1,341 @@
+﻿#pragma once
+#include <string>
+#include <algorithm>
+#include <SDL.h>
+#include "SquareMatrixData.h"
+#include "RenderTarget.h"
+#include "Map.h"
+#include "Arena.h"
+
+class Blocks {
+    class Block {
+    public:
+        unsigned short int sizeY, sizeX;
+        char** arr;
+        int* bottom;//lowest filled row of every column, -1 for empty columns
+        Block* next;
+        Block* nextForm;
+
+        Block(int sizeY, int sizeX, std::string block, Block* nextForm = nullptr) :sizeY(sizeY), sizeX(sizeX) {
+            arr = arenaArray<char*>(sizeY);
+            for (int k = block.length(), f = 0, y = 0, x = 0; f < k; f++) {
+                if (x == 0)arr[y] = arenaArray<char>(sizeX);
+                if (block[f] != 'n') {
+                    arr[y][x] = block[f];
+                    x++;
+                }
+                else {
+                    x = 0;
+                    y++;
+                }
+            }
+            bottom = arenaArray<int>(sizeX);
+            for (int x = 0, y; x < sizeX; x++) {
+                for (bottom[x] = -1, y = 0; y < sizeY; y++)if (arr[y][x] != ' ')bottom[x] = y;
+            }
+            next = nullptr;
+            this->nextForm = nextForm;
+        }
+
+        void addForm(int sizeY, int sizeX, std::string block);
+    };
+    Block* head = nullptr, * current = nullptr, * currentForm = nullptr;
+public:
+    RenderTarget* target = nullptr;
+
+    SquareMatrixData* blocksMatrix = nullptr;
+    /*   Stack<Block> blocksPool;
+       int blocksPoolSize = 4;*/
+    int blocksPoolSize = 5;
+    Block** blocksPool = arenaArray<Block*>(blocksPoolSize);
+
+    Map* BlocksMap = nullptr;
+    unsigned int countOfBlocks = 0;
+
+    Block* fallingBlock = nullptr;
+    unsigned short int fallingBlockPosY = 0, fallingBlockPosX = 0;
+    //ghost cells currently in the map, see updateGhost
+    Block* ghostBlock = nullptr;
+    int ghostPosY = 0, ghostPosX = 0;
+
+
+
+    Block* operator[](int pos) {
+        if (head != nullptr) {
+            int counter = 0;
+            for (current = head; current != nullptr && counter < pos; counter++, current = current->next);
+            if (pos == counter && current != nullptr)return current;
+        }
+        return(nullptr);
+    }
+
+    Blocks(Map& obj) :BlocksMap(&obj) {}
+    void addBlock(int sizeY, int sizeX, std::string block);
+    int indexOf(Block* obj);
+    int formIndexOf(Block* obj, int& form);
+    Block* formAt(int index, int form);
+    int formsOf(int index);
+    int pickBlock(Block* obj);
+    void resetBlocks();
+    int moveBlock(int posY, int posX);
+    int shiftBlock(int stepY, int stepX, int steps);
+    bool fitsBelow(int distance);
+    int dropDistance();
+    int hardDrop();
+    void clearGhost();
+    void updateGhost();
+    void changeForm();
+    void renderBlockStrick(int type, int first);
+};
+
+inline void Blocks::addBlock(int sizeY, int sizeX, std::string block) {
+    if (head == nullptr)head = arenaNew<Block>(sizeY, sizeX, block);
+    else {
+        for (current = head; current->next != nullptr; current = current->next);
+        current->next = arenaNew<Block>(sizeY, sizeX, block);
+    }
+    countOfBlocks++;
+}
+
+inline void Blocks::Block::addForm(int sizeY, int sizeX, std::string block) {
+    if (this != nullptr) {
+        if (this->nextForm == nullptr)this->nextForm = arenaNew<Block>(sizeY, sizeX, block, this);
+        else {
+            Block* currentForm;
+            for (currentForm = this; currentForm->nextForm != this; currentForm = currentForm->nextForm);
+            currentForm->nextForm = arenaNew<Block>(sizeY, sizeX, block, this);
+        }
+    }
+}
+
+//position of a block added with addBlock, -1 for forms and foreign blocks
+inline int Blocks::indexOf(Block* obj) {
+    int counter = 0;
+    for (current = head; current != nullptr && current != obj; current = current->next, counter++);
+    return (current != nullptr) ? counter : -1;
+}
+
+//position of the block `obj` is a form of, form counts nextForm steps from it; -1 for foreign blocks
+inline int Blocks::formIndexOf(Block* obj, int& form) {
+    int counter = 0;
+    for (current = head; current != nullptr; current = current->next, counter++) {
+        for (form = 0, currentForm = current; currentForm != nullptr; form++) {
+            if (currentForm == obj)return counter;
+            currentForm = currentForm->nextForm;
+            if (currentForm == current)break;
+        }
+    }
+    form = -1;
+    return -1;
+}
+
+inline Blocks::Block* Blocks::formAt(int index, int form) {
+    Block* block = (*this)[index];
+    for (; block != nullptr && form > 0; form--)block = block->nextForm;
+    return block;
+}
+
+//count of forms the block at `index` turns through, 0 for no block
+inline int Blocks::formsOf(int index) {
+    Block* block = (*this)[index];
+    int forms = 0;
+    for (currentForm = block; currentForm != nullptr; forms++) {
+        currentForm = currentForm->nextForm;
+        if (currentForm == block)return forms + 1;
+    }
+    return forms;
+}
+
+inline int Blocks::pickBlock(Block* obj) {
+    if (head != nullptr) {
+        fallingBlock = obj;
+        fallingBlockPosX = (BlocksMap->mapSizeX() - fallingBlock->sizeX) / 2;
+        fallingBlockPosY = 0;
+        return 1;
+    }
+    return 0;
+}
+
+//forgets the falling block and its ghost, for a new game on a cleared map
+inline void Blocks::resetBlocks() {
+    fallingBlock = nullptr;
+    ghostBlock = nullptr;
+    fallingBlockPosY = 0;
+    fallingBlockPosX = 0;
+}
+
+inline int Blocks::moveBlock(int posY, int posX) {
+    if (fallingBlock != nullptr) {
+        BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr, 0);
+        if (!BlocksMap->canChange(posY, posX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr)) {
+            BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr);
+            return 0;
+        }
+        else {
+            this->fallingBlockPosY = posY;
+            this->fallingBlockPosX = posX;
+            updateGhost();
+            BlocksMap->changeMap(posY, posX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr);
+            return 1;
+        }
+    }
+    else return 0;
+}
+
+//moves the falling block up to `steps` times by (stepY, stepX) in one sweep: the block leaves the map once,
+//free positions are found with canChange and it is placed once at the last one. Returns the steps made.
+inline int Blocks::shiftBlock(int stepY, int stepX, int steps) {
+    if (fallingBlock == nullptr || steps <= 0)return 0;
+
+    BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr, 0);
+    int moved = 0;
+    for (int y = fallingBlockPosY + stepY, x = fallingBlockPosX + stepX;
+        moved < steps && y >= 0 && x >= 0 && BlocksMap->canChange(y, x, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr);
+        y += stepY, x += stepX, moved++);
+
+    fallingBlockPosY += moved * stepY;
+    fallingBlockPosX += moved * stepX;
+    if (moved > 0)updateGhost();
+    BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr);
+    return moved;
+}
+
+//true when the falling block fits `distance` rows lower, its own cells count as free
+inline bool Blocks::fitsBelow(int distance) {
+    if (fallingBlockPosY + distance + fallingBlock->sizeY > BlocksMap->mapSizeY())return false;
+
+    for (int y = 0, x, ownY; y < fallingBlock->sizeY; y++) {
+        for (x = 0; x < fallingBlock->sizeX; x++) {
+            if (fallingBlock->arr[y][x] == ' ')continue;
+            ownY = y + distance;
+            if (ownY < fallingBlock->sizeY && fallingBlock->arr[ownY][x] != ' ')continue;
+            if (BlocksMap->isSolid(BlocksMap->getCell(fallingBlockPosY + ownY, fallingBlockPosX + x)))return false;
+        }
+    }
+    return true;
+}
+
+//rows the falling block can fall: column tops against the block's bottom profile, O(width).
+//A block tucked under an overhang is below its column top, that case steps row by row.
+inline int Blocks::dropDistance() {
+    if (fallingBlock == nullptr)return 0;
+
+    int distance = BlocksMap->mapSizeY();
+    for (int x = 0, cellY; x < fallingBlock->sizeX; x++) {
+        if (fallingBlock->bottom[x] < 0)continue;
+        cellY = fallingBlockPosY + fallingBlock->bottom[x];
+        if (cellY >= BlocksMap->columnTop(fallingBlockPosX + x)) {
+            for (distance = 0; fitsBelow(distance + 1); distance++);
+            return distance;
+        }
+        distance = std::min(distance, BlocksMap->columnTop(fallingBlockPosX + x) - cellY - 1);
+    }
+    return distance;
+}
+
+//drops the falling block to its landing row, returns the rows dropped
+inline int Blocks::hardDrop() {
+    int distance = dropDistance();
+    if (distance > 0) {
+        BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr, 0);
+        fallingBlockPosY += distance;
+        BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr);
+    }
+    clearGhost();
+    return distance;
+}
+
+//removes ghost cells the falling block didn't cover
+inline void Blocks::clearGhost() {
+    if (ghostBlock == nullptr)return;
+
+    for (int y = 0, x; y < ghostBlock->sizeY; y++) {
+        for (x = 0; x < ghostBlock->sizeX; x++) {
+            if (ghostBlock->arr[y][x] != ' ' && BlocksMap->getCell(ghostPosY + y, ghostPosX + x) == BlocksMap->ghostSymbol)BlocksMap->setCell(ghostPosY + y, ghostPosX + x, ' ');
+        }
+    }
+    ghostBlock = nullptr;
+}
+
+//moves the ghost under the falling block, call after every move of it and before the block is
+//placed back with changeMap: that render draws block and ghost together
+inline void Blocks::updateGhost() {
+    if (BlocksMap->ghostSymbol == 0 || fallingBlock == nullptr)return;
+
+    clearGhost();
+    ghostBlock = fallingBlock;
+    ghostPosY = fallingBlockPosY + dropDistance();
+    ghostPosX = fallingBlockPosX;
+    for (int y = 0, x; y < ghostBlock->sizeY; y++) {
+        for (x = 0; x < ghostBlock->sizeX; x++) {
+            if (ghostBlock->arr[y][x] != ' ' && BlocksMap->getCell(ghostPosY + y, ghostPosX + x) == ' ')BlocksMap->setCell(ghostPosY + y, ghostPosX + x, BlocksMap->ghostSymbol);
+        }
+    }
+    BlocksMap->isChanged = true;
+}
+
+inline void Blocks::changeForm() {
+    if (fallingBlock->nextForm != nullptr) {
+        BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr, 0);
+        for (int y = 0, x; y <= fallingBlock->nextForm->sizeY; y++) {
+            for (x = 0; x <= fallingBlock->nextForm->sizeX; x++) {
+                if (BlocksMap->canChange(fallingBlockPosY - y, fallingBlockPosX - x, fallingBlock->nextForm->sizeY, fallingBlock->nextForm->sizeX, fallingBlock->nextForm->arr)) {
+                    fallingBlock = fallingBlock->nextForm;
+                    fallingBlockPosY -= y;
+                    fallingBlockPosX -= x;
+                    updateGhost();
+                    BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr);
+                    return;
+                }
+            }
+        }
+        BlocksMap->changeMap(fallingBlockPosY, fallingBlockPosX, fallingBlock->sizeY, fallingBlock->sizeX, fallingBlock->arr);
+    }
+}
+
+//blocksPool[first..] in the strip, startGame shows blocksPool[1..] once the pool was shifted
+inline void Blocks::renderBlockStrick(int type = 0, int first = 0) {
+    static SDL_Rect* rect = nullptr;
+
+    if (this->target == nullptr)return;
+    this->BlocksMap->mapColors();
+
+    if (!type) {
+        this->target->fillRect(this->blocksMatrix->backgroundRect, this->target->mapColor(this->blocksMatrix->backgroundColorRGB));
+        rect = new SDL_Rect{
+            this->blocksMatrix->matrix[0][0].x,this->blocksMatrix->matrix[0][0].y,
+            this->blocksMatrix->getMatrixFieldSizeX(false),this->blocksMatrix->getMatrixFieldSizeY(false)
+        };
+        this->target->fillRect(rect, this->target->mapColor(this->blocksMatrix->squareColorRGB));
+        delete rect;
+    }
+
+    float sX = this->blocksMatrix->matrix[0][0].x, sXI, sY;
+    int verticalOffset = this->blocksMatrix->SizeY / (this->blocksPoolSize - 1);
+
+    for (int k = 0; k < this->blocksPoolSize - 1; k++) {
+
+        sXI = this->blocksMatrix->squareSize * (this->blocksMatrix->SizeX - this->blocksPool[first + k]->sizeX) / 2.0 + sX;
+        sY = this->blocksMatrix->matrix[verticalOffset * k][0].y + ((this->blocksMatrix->SizeY - verticalOffset) - this->blocksPool[first + k]->sizeY) / 2.0;
+
+        for (int y = 0, x; y < this->blocksPool[first + k]->sizeY; y++) {
+            for (x = 0; x < this->blocksPool[first + k]->sizeX; x++) {
+
+                if (this->blocksPool[first + k]->arr[y][x] != ' ') {
+                    rect = new SDL_Rect{
+                        static_cast<int>(sXI),static_cast<int>(sY),
+                        this->blocksMatrix->squareSize,this->blocksMatrix->squareSize
+                    };
+                    this->target->fillRect(rect, this->BlocksMap->getSymbolPixel(this->blocksPool[first + k]->arr[y][x]));
+                    delete rect;
+                }
+                sXI += this->blocksMatrix->squareSize + this->blocksMatrix->verticalPadding;
+            }
+            sXI = this->blocksMatrix->squareSize * (this->blocksMatrix->SizeX - this->blocksPool[first + k]->sizeX) / 2.0 + sX;
+            sY += this->blocksMatrix->squareSize + this->blocksMatrix->horizontalPadding;
+        }
+
+    }
+
+    this->target->present();
+}
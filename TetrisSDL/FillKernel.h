@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <SDL.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FILL_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+//gcc and clang only emit AVX2 inside functions marked for it, MSVC always can
+#if defined(FILL_KERNEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define FILL_TARGET_AVX2 __attribute__((target("avx2")))
+#define FILL_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define FILL_TARGET_AVX2
+#define FILL_TARGET_SSE2
+#endif
+
+//Solid fill of 32-bit pixels written straight into the surface, an alternative to SDL_FillRect
+//for the small squares the renderers draw. Row writer is picked once from the CPU features.
+
+typedef void (*FillRowFunc)(Uint32* row, int count, Uint32 color);
+
+inline void fillRowScalar(Uint32* row, int count, Uint32 color) {
+    for (int k = 0; k < count; k++)row[k] = color;
+}
+
+#ifdef FILL_KERNEL_X86
+FILL_TARGET_SSE2 inline void fillRowSSE2(Uint32* row, int count, Uint32 color) {
+    __m128i pixels = _mm_set1_epi32((int)color);
+    int k = 0;
+    for (; k + 4 <= count; k += 4)_mm_storeu_si128((__m128i*)(row + k), pixels);
+    for (; k < count; k++)row[k] = color;
+}
+
+FILL_TARGET_AVX2 inline void fillRowAVX2(Uint32* row, int count, Uint32 color) {
+    __m256i pixels = _mm256_set1_epi32((int)color);
+    int k = 0;
+    for (; k + 8 <= count; k += 8)_mm256_storeu_si256((__m256i*)(row + k), pixels);
+    if (k + 4 <= count) {
+        _mm_storeu_si128((__m128i*)(row + k), _mm256_castsi256_si128(pixels));
+        k += 4;
+    }
+    for (; k < count; k++)row[k] = color;
+}
+#endif
+
+inline FillRowFunc pickFillRow() {
+#ifdef FILL_KERNEL_X86
+    if (SDL_HasAVX2())return fillRowAVX2;
+    if (SDL_HasSSE2())return fillRowSSE2;
+#endif
+    return fillRowScalar;
+}
+
+inline const char* fillRowName(FillRowFunc func) {
+#ifdef FILL_KERNEL_X86
+    if (func == fillRowAVX2)return "avx2";
+    if (func == fillRowSSE2)return "sse2";
+#endif
+    return "scalar";
+}
+
+inline FillRowFunc fillRow() {
+    static FillRowFunc func = pickFillRow();
+    return func;
+}
+
+//surface must be 32bpp; rects are clipped to the surface clip rect like SDL_FillRects
+inline int fillRects32(SDL_Surface* surface, const SDL_Rect* rects, int count, Uint32 color, FillRowFunc func = fillRow()) {
+    if (surface == NULL || surface->format->BytesPerPixel != 4)return -1;
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0)return -1;
+
+    SDL_Rect clipped;
+    for (int k = 0; k < count; k++) {
+        if (!SDL_IntersectRect(&rects[k], &surface->clip_rect, &clipped))continue;
+
+        Uint8* row = (Uint8*)surface->pixels + clipped.y * surface->pitch + clipped.x * 4;
+        for (int y = 0; y < clipped.h; y++, row += surface->pitch)func((Uint32*)row, clipped.w, color);
+    }
+
+    if (SDL_MUSTLOCK(surface))SDL_UnlockSurface(surface);
+    return 0;
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include <SDL.h>
+
+//Everything the render thread needs to draw one frame, copied out of the simulation.
+//Plain data only: the falling block is already part of field.
+struct FrameSnapshot {
+    static const int maxRows = 32, maxColumns = 16, maxPreview = 8;
+
+    Uint32 sequence = 0;
+    int score = 0;
+    Uint8 sizeY = 0, sizeX = 0;
+    Uint8 previewCount = 0;
+    Uint8 preview[maxPreview];//Blocks indices of the blocks strip, top to bottom
+    Uint32 clearedRows = 0;//rows removed by the last line clear, see Map::clearedRows
+    Uint32 clearSequence = 0;//changes on every line clear, so the renderer flashes it once
+    bool isPaused = false;//board is covered
+    bool isGameOver = false;//results are shown, the next frame without it is a new game
+    char field[maxRows * maxColumns];//sizeY * sizeX symbols, Map::saveField layout
+};
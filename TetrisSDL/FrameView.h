@@ -0,0 +1,132 @@
+﻿#pragma once
+#include <cstring>
+#include <SDL.h>
+#include "Map.h"
+#include "Blocks.h"
+#include "Game.h"
+#include "FrameSnapshot.h"
+
+//Draws the frames a Game publishes with view Map/Blocks/Game that are set up like the simulated ones
+//and only ever drawn from snapshots: cells, digits and the preview are redrawn only where they changed.
+//RenderThread draws with it on its own thread, VersusSession in place when there is no render thread.
+class FrameView {
+    Map* viewMap;
+    Blocks* viewBlocks;
+    Game* view;
+    bool isDrawn = false;//the first frame is drawn whole
+    //state of the drawn picture
+    int shownScore = 0;
+    Uint8 shownPreview[FrameSnapshot::maxPreview];
+    char shownField[FrameSnapshot::maxRows * FrameSnapshot::maxColumns];
+    Uint32 shownClear = 0;
+    bool isCovered = false;
+    bool isResults = false;
+    //line clear blink, see drawFlash
+    Uint32 flashRows = 0, flashStart = 0;
+    int flashPhase = -1;
+
+    bool isShown(const FrameSnapshot& frame);
+    void drawFlash();
+public:
+    FrameView(Game& view, Map& viewMap, Blocks& viewBlocks) :
+        viewMap(&viewMap), viewBlocks(&viewBlocks), view(&view) {}
+
+    bool fits();
+    void drawFrame(const FrameSnapshot& frame);
+    bool isFlashing() { return this->flashRows != 0; }
+    void tick();
+};
+
+//false for views larger than FrameSnapshot holds
+inline bool FrameView::fits() {
+    return this->viewMap->mapSizeY() <= FrameSnapshot::maxRows && this->viewMap->mapSizeX() <= FrameSnapshot::maxColumns
+        && this->viewBlocks->blocksPoolSize - 1 <= FrameSnapshot::maxPreview;
+}
+
+//same picture as the one drawn last
+inline bool FrameView::isShown(const FrameSnapshot& frame) {
+    if (!this->isDrawn || frame.score != this->shownScore || frame.clearSequence != this->shownClear
+        || frame.isPaused != this->isCovered || frame.isGameOver != this->isResults)return false;
+    for (int k = 0; k < frame.previewCount; k++)if (frame.preview[k] != this->shownPreview[k])return false;
+    return memcmp(frame.field, this->shownField, frame.sizeY * frame.sizeX) == 0;
+}
+
+//frames that change nothing on screen are neither drawn nor presented
+inline void FrameView::drawFrame(const FrameSnapshot& frame) {
+    if (isShown(frame)) {
+        tick();
+        return;
+    }
+    bool full = !this->isDrawn;
+    this->isDrawn = true;
+    //results stay until the restarted game redraws everything
+    if (this->isResults && !frame.isGameOver)full = true;
+    viewMap->loadField(frame.field);
+    memcpy(this->shownField, frame.field, frame.sizeY * frame.sizeX);
+    if (full)this->shownClear = frame.clearSequence;
+    if (frame.clearSequence != this->shownClear) {
+        this->shownClear = frame.clearSequence;
+        this->flashRows = frame.clearedRows;
+        this->flashStart = SDL_GetTicks();
+        this->flashPhase = -1;
+    }
+    if (frame.isGameOver) {
+        viewMap->highestPoint = 0;
+        this->flashRows = 0;
+        if (!this->isResults)viewMap->renderResults();
+    }
+    else if (frame.isPaused) {
+        if (!this->isCovered)viewMap->renderCover();
+        this->isCovered = true;
+    }
+    else if (this->flashRows != 0)drawFlash();
+    else viewMap->renderField((full || this->isCovered) ? 0 : 1);
+    if (!frame.isPaused)this->isCovered = false;
+    this->isResults = frame.isGameOver;
+
+    if (full) {
+        view->renderNums(0);
+        this->shownScore = frame.score;
+    }
+    if (frame.score != this->shownScore) {
+        view->setScore(frame.score);
+        view->renderNums(1);
+        this->shownScore = frame.score;
+    }
+
+    //the pool is empty until the game spawned its first block
+    bool isPreviewChanged = full, isPreviewFilled = true;
+    for (int k = 0; k < frame.previewCount; k++) {
+        if (frame.preview[k] != this->shownPreview[k])isPreviewChanged = true;
+        this->shownPreview[k] = frame.preview[k];
+        viewBlocks->blocksPool[k] = (*viewBlocks)[frame.preview[k]];
+        if (viewBlocks->blocksPool[k] == nullptr)isPreviewFilled = false;
+    }
+    if (isPreviewChanged && isPreviewFilled)viewBlocks->renderBlockStrick();
+}
+
+//goes on with a line clear blink between frames
+inline void FrameView::tick() {
+    if (this->flashRows != 0 && !this->isCovered)drawFlash();
+}
+
+//same blink as Map::checkStreak does in place, timed instead of SDL_Delay:
+//100ms flash, 150ms field, 100ms flash, then the field again
+inline void FrameView::drawFlash() {
+    Uint32 elapsed = SDL_GetTicks() - this->flashStart;
+    int phase = (elapsed < 100) ? 0 : (elapsed < 250) ? 1 : (elapsed < 350) ? 2 : 3;
+    if (phase == this->flashPhase)return;
+    this->flashPhase = phase;
+
+    if (phase % 2) {
+        viewMap->renderField(0);
+        if (phase == 3)this->flashRows = 0;
+        return;
+    }
+
+    viewMap->mapColors();
+    for (int y = 0; y < viewMap->mapSizeY() && y < 32; y++) {
+        if (this->flashRows & (1u << y))viewMap->target->fillRects(viewMap->mapMatrix->matrix[y], viewMap->mapSizeX(), viewMap->flashPixel);
+    }
+    viewMap->target->present();
+}
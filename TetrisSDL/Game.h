@@ -0,0 +1,773 @@
+﻿#pragma once
+#include <string>
+#include <algorithm>
+#include <SDL.h>
+#include "SquareMatrixData.h"
+#include "RenderTarget.h"
+#include "Map.h"
+#include "Blocks.h"
+#include "FrameSnapshot.h"
+#include "GameState.h"
+#include "SaveFile.h"
+#include "SpectatorStream.h"
+#include "TripleBuffer.h"
+#include "InputEvent.h"
+#include "Arena.h"
+
+class Game {
+    bool digitNums[11][13] = {
+        {0,0,0, 0,0, 0,0,0, 0,0, 0,0,0},//void
+        {1,1,1, 1,1, 1,0,1, 1,1, 1,1,1},//0
+        {0,0,1, 0,1, 0,0,1, 0,1, 0,0,1},//1
+        {1,1,1, 0,1, 1,1,1, 1,0, 1,1,1},//2
+        {1,1,1, 0,1, 1,1,1, 0,1, 1,1,1},//3
+        {1,0,1, 1,1, 1,1,1, 0,1, 0,0,1},//4
+        {1,1,1, 1,0, 1,1,1, 0,1, 1,1,1},//5
+        {1,1,1, 1,0, 1,1,1, 1,1, 1,1,1},//6
+        {1,1,1, 0,1, 0,0,1, 0,1, 0,0,1},//7
+        {1,1,1, 1,1, 1,1,1, 1,1, 1,1,1},//8
+        {1,1,1, 1,1, 1,1,1, 0,1, 1,1,1},//9
+    };
+    int intRanks[3]{
+        0x14C814,
+        0xC81414,
+        0xC814C8
+    };
+    Blocks* GameBlocks = nullptr;
+    Map* GameMap = nullptr;
+    //score and proggressions
+    double refreshIntevalMS = 0;
+    int score = 0, scoreProgressionLevels, * scoreTrigger = nullptr;
+    double* scoreProgression;
+    //render score
+    SDL_Rect* numRects = nullptr;//9 digits of 13 segments each, in digitNums order
+    SDL_Rect* background = nullptr;
+    SquareMatrixData* numMatrixData;
+    char* scoreNumbers = nullptr;
+    RenderLayer* glyphAtlas = nullptr;
+    int glyphSizeX = 0, glyphSizeY = 0;
+    //render thread
+    Uint32 frameSequence = 0, clearSequence = 0;
+    //held keys, see holdKey
+    enum RepeatKeys { repeatLeft = 0, repeatRight = 1, repeatDown = 2 };
+    struct RepeatKey {
+        bool isHeld = false;
+        bool isCharged = false;//first repeat done
+        double nextTime = 0;
+    };
+    RepeatKey repeatKeys[3];
+    bool isPaused = false;
+    bool isGameOver = false;
+    //rest of the game state, see snapshot
+    int currentLevel = 0, prevBlock = 0;
+    bool isSeted = false;
+    double gravityTime = 0, pauseTime = 0;//inputClockMS of the last gravity step and of the pause
+    Uint32 randomState = 1;
+    Uint8 heldButtons = 0;//buttons of the last stepFrame
+    int garbageIn = 0;//rows the other player sent, under the stack when the falling block locks
+    int garbageOut = 0;//rows for the other player, see takeGarbage
+    bool isResumed = false;//set by restore, startGame goes on from the restored state
+public:
+    //auto repeat of held movement keys, in ms: left/right repeat every arrMS after dasMS,
+    //down every softDropMS from the press. 0 moves to the wall/floor at once.
+    double dasMS = 167, arrMS = 33, softDropMS = 33;
+    RenderTarget* target = NULL;
+    TripleBuffer<FrameSnapshot>* frames = nullptr;//set by RenderThread::start, the game then only publishes frames
+    SDL_sem* framesReady = NULL;
+    InputQueue* inputEvents = nullptr;//set by InputThread::run, otherwise the game polls SDL itself
+    SDL_sem* inputReady = NULL;
+    SaveWriter* saves = nullptr;//checkpoints go here on every new block, pause and quit; game over discards them
+    SpectatorStream* spectators = nullptr;//every published frame is streamed to it as well
+
+    Game(Blocks& obj1, Map& obj2, SquareMatrixData& obj3, int scoreProgressionLevels = 0, double* scoreProgression = nullptr, int* scoreTrigger = nullptr) :
+        GameBlocks(&obj1), GameMap(&obj2), numMatrixData(&obj3),
+        scoreProgressionLevels(scoreProgressionLevels), scoreProgression(scoreProgression)
+    {
+
+        if (this->scoreProgression == nullptr || this->scoreProgressionLevels < 1 || scoreTrigger == nullptr) {
+            this->scoreProgressionLevels = 7;
+            this->scoreProgression = arenaArray<double>(7);
+            this->scoreTrigger = arenaArray<int>(6);
+            const double progression[7] = { 300,250,200,150,120,100,80 };
+            const int trigger[6] = { 3000,5000,15000,40000,80000,120000 };
+            std::copy(progression, progression + 7, this->scoreProgression);
+            std::copy(trigger, trigger + 6, this->scoreTrigger);
+        }
+        scoreNumbers = arenaArray<char>(9);
+        std::fill(scoreNumbers, scoreNumbers + 9, '/');
+
+        //headless games (server) get an empty matrix, the score is never drawn
+        if (numMatrixData->SizeY == 0 || numMatrixData->SizeX == 0)return;
+
+        background = arenaNew<SDL_Rect>(SDL_Rect{ numMatrixData->startX, numMatrixData->startY,numMatrixData->SizeX, numMatrixData->SizeY });
+
+        int betweenNumsPadding = 6;
+        //creating numRects
+        numRects = arenaArray<SDL_Rect>(9 * 13);
+        for (int nums = 0, y, x, maxX, digit = 0, leftOffset = numMatrixData->leftOffset + numMatrixData->startX, numLeftOffset, topOffset; nums < 9; nums++) {
+
+            topOffset = numMatrixData->startY + numMatrixData->topOffset;
+
+            for (y = 0; y < 5; y++, topOffset += numMatrixData->squareSize + numMatrixData->verticalPadding) {
+
+                maxX = ((y + 1) % 2) + 2;
+                numLeftOffset = leftOffset;
+
+                for (x = 0; x < maxX; x++, digit++, numLeftOffset += numMatrixData->horizontalPadding + numMatrixData->squareSize) {
+                    numRects[digit] = SDL_Rect{ numLeftOffset, topOffset,numMatrixData->squareSize,numMatrixData->squareSize };
+                    if (maxX == 2 && x == 0)numLeftOffset += numMatrixData->horizontalPadding + numMatrixData->squareSize;
+                }
+            }
+
+            leftOffset = numLeftOffset + betweenNumsPadding;
+        }
+    }
+    int getScore() { return score; }
+    void setScore(int value) { score = value; }
+    bool getGameOver() { return isGameOver; }
+    void addGarbage(int rows) { garbageIn = std::min(garbageIn + rows, GameMap->mapSizeY()); }
+    int takeGarbage() { int rows = garbageOut; garbageOut = 0; return rows; }
+    void renderGlyphs();
+    void drawGlyph(int position, int rank, int glyph);
+    void renderNums(int type);
+    void publishFrame();
+    void resetGame();
+    void seedRandom(Uint32 seed) { randomState = (seed * 2654435761u) | 1; }
+    int randomBlock();
+    bool snapshot(GameState& state, double now = -1);
+    bool restore(const GameState& state, double now = -1);
+    void saveGame();
+    void fillPool();
+    void beginGame();
+    bool spawnBlock(double now);
+    int lockBlock();
+    bool insertGarbage();
+    bool nextBlock(double now);
+    void shiftBy(int stepY, int stepX);
+    bool pressButtons(Uint8 buttons, double time);
+    bool applyRepeats(double now);
+    double nextGravityTime() { return gravityTime + refreshIntevalMS; }
+    bool gravityStep(double now);
+    void stepFrame(Uint8 buttons, double now);
+    void renderGame();
+    bool nextInput(InputEvent& event, double before);
+    void waitInput(double until = -1);
+    int repeatKeyOf(SDL_Keycode key);
+    double repeatRate(int key) { return (key == repeatDown) ? softDropMS : arrMS; }
+    void holdKey(int key, double time);
+    int repeatSteps(int key, double now);
+    double nextRepeatTime(double until);
+    double moveDelay() { return refreshIntevalMS * (1 - currentLevel) / 10; }
+    void startGame();
+};
+
+//every glyph (void and 0-9) in every rank color, drawn once
+inline void Game::renderGlyphs() {
+    SDL_Rect* first = &numRects[0];
+    this->glyphSizeX = numRects[2].x + numMatrixData->squareSize - first->x;//end of the top row
+    this->glyphSizeY = numRects[10].y + numMatrixData->squareSize - first->y;//bottom row
+
+    SDL_Rect atlasRect{ 0, 0, 11 * glyphSizeX, 3 * glyphSizeY };
+    this->glyphAtlas = new RenderLayer;
+    this->glyphAtlas->createLayer(&atlasRect);
+
+    for (int rank = 0, glyph, digit; rank < 3; rank++) {
+        for (glyph = 0; glyph < 11; glyph++) {
+            SDL_Rect cell{ glyph * glyphSizeX, rank * glyphSizeY, glyphSizeX, glyphSizeY };
+            this->glyphAtlas->fillRect(&cell, numMatrixData->backgroundColorRGB);
+
+            for (digit = 0; digit < 13; digit++) {
+                SDL_Rect segment = numRects[digit];
+                segment.x += cell.x - first->x;
+                segment.y += cell.y - first->y;
+                this->glyphAtlas->fillRect(&segment, (digitNums[glyph][digit]) ? intRanks[rank] : numMatrixData->squareColorRGB);
+            }
+        }
+    }
+}
+
+//glyph: 0 - void, 1..10 - digits 0..9 (digitNums order)
+inline void Game::drawGlyph(int position, int rank, int glyph) {
+    SDL_Rect source{ glyph * glyphSizeX, rank * glyphSizeY, glyphSizeX, glyphSizeY };
+    target->drawLayer(this->glyphAtlas, &source, &numRects[position * 13]);
+}
+
+inline void Game::renderNums(int type = 1) {
+    if (this->target == NULL || this->numRects == nullptr)return;
+    if (this->glyphAtlas == nullptr)renderGlyphs();
+
+    if (type) {
+        //digits from the lowest one, only changed ones are copied from the atlas
+        for (int k = 0, value = this->score; k < 9 && (k == 0 || value > 0); k++, value /= 10) {
+            char digit = '0' + value % 10;
+            if (digit != scoreNumbers[k]) {
+                drawGlyph(8 - k, k / 3, digit - 47);//11 constant in class::Game constructor
+                scoreNumbers[k] = digit;
+            }
+        }
+    }
+    else {
+        this->target->fillRect(background, target->mapColor(numMatrixData->backgroundColorRGB));
+
+        for (int nums = 0; nums < 9; nums++) {
+            drawGlyph(nums, 0, 0);
+            scoreNumbers[nums] = '/';
+        }
+    }
+
+    this->target->present();
+
+}
+
+//copies the visible state for the render thread; blocksPool[1..] is the blocks strip once startGame shifted it
+inline void Game::publishFrame() {
+    if (this->spectators != nullptr && snapshot(this->spectators->stateSlot()))this->spectators->post();
+    if (this->frames == nullptr)return;
+
+    FrameSnapshot& frame = this->frames->writeSlot();
+    frame.sequence = ++this->frameSequence;
+    frame.score = this->score;
+    frame.sizeY = GameMap->mapSizeY();
+    frame.sizeX = GameMap->mapSizeX();
+    GameMap->saveField(frame.field);
+
+    frame.previewCount = std::min(GameBlocks->blocksPoolSize - 1, (int)FrameSnapshot::maxPreview);
+    for (int k = 0; k < frame.previewCount; k++)frame.preview[k] = GameBlocks->indexOf(GameBlocks->blocksPool[k + 1]);
+    frame.clearedRows = GameMap->clearedRows;
+    frame.clearSequence = this->clearSequence;
+    frame.isPaused = this->isPaused;
+    frame.isGameOver = this->isGameOver;
+
+    this->frames->publish();
+    if (this->framesReady != NULL)SDL_SemPost(this->framesReady);
+}
+
+//new game on the same Map, Blocks and SquareMatrixData, nothing is reallocated
+inline void Game::resetGame() {
+    GameMap->clearField();
+    GameBlocks->resetBlocks();
+    this->score = 0;
+    this->isPaused = false;
+    this->isGameOver = false;
+    this->isSeted = false;
+    this->isResumed = false;
+    this->heldButtons = 0;
+    this->garbageIn = 0;
+    this->garbageOut = 0;
+    for (int k = 0; k < 3; k++)repeatKeys[k].isHeld = false;
+}
+
+//xorshift, kept in the game state so restored games draw the same blocks; no block twice in a row
+inline int Game::randomBlock() {
+    int blockNum;
+    do {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        blockNum = randomState % GameBlocks->countOfBlocks;
+    } while (prevBlock == blockNum);
+    prevBlock = blockNum;
+    return blockNum;
+}
+
+//`now` is the inputClockMS the relative times are taken from, -1 for the current one.
+//Fails for maps and pools larger than GameState holds or more than 15 symbols.
+inline bool Game::snapshot(GameState& state, double now) {
+    int sizeY = GameMap->mapSizeY(), sizeX = GameMap->mapSizeX();
+    if (sizeY > GameState::maxRows || sizeX > GameState::maxColumns || GameMap->symbolsCount > 15
+        || GameBlocks->blocksPoolSize > GameState::maxPool)return false;
+    if (now < 0)now = inputClockMS();
+
+    //the falling block is in the field unless it didn't fit (game over)
+    char field[GameState::maxRows * GameState::maxColumns];
+    GameMap->saveField(field);
+    auto block = GameBlocks->fallingBlock;
+    if (block != nullptr && !this->isGameOver) {
+        for (int y = 0, x; y < block->sizeY; y++) {
+            for (x = 0; x < block->sizeX; x++) {
+                if (block->arr[y][x] != ' ')field[(GameBlocks->fallingBlockPosY + y) * sizeX + GameBlocks->fallingBlockPosX + x] = ' ';
+            }
+        }
+    }
+    memset(state.cells, 0, sizeof(state.cells));
+    for (int k = 0, symbol; k < sizeY * sizeX; k++) {
+        symbol = (field[k] == GameMap->ghostSymbol) ? -1 : GameMap->getSymbolNum(field[k]);
+        state.cells[k / 2] |= (symbol + 1) << (k % 2 * 4);
+    }
+
+    int form;
+    state.sizeY = sizeY;
+    state.sizeX = sizeX;
+    state.highestPoint = GameMap->highestPoint;
+    state.poolSize = GameBlocks->blocksPoolSize;
+    for (int k = 0; k < GameState::maxPool; k++)state.pool[k] = (k < state.poolSize) ? GameBlocks->indexOf(GameBlocks->blocksPool[k]) : -1;
+    state.fallingBlock = GameBlocks->formIndexOf(block, form);
+    state.fallingForm = form;
+    state.fallingPosY = GameBlocks->fallingBlockPosY;
+    state.fallingPosX = GameBlocks->fallingBlockPosX;
+    state.prevBlock = this->prevBlock;
+    state.currentLevel = this->currentLevel;
+    state.isSeted = this->isSeted;
+    state.isPaused = this->isPaused;
+    state.isGameOver = this->isGameOver;
+    state.heldButtons = this->heldButtons;
+    state.garbageIn = this->garbageIn;
+    state.randomState = this->randomState;
+    state.score = this->score;
+    state.gravityElapsed = (this->isPaused ? this->pauseTime : now) - this->gravityTime;
+    state.pausedFor = this->isPaused ? now - this->pauseTime : 0;
+    for (int k = 0; k < 3; k++) {
+        state.repeatKeys[k].isHeld = repeatKeys[k].isHeld;
+        state.repeatKeys[k].isCharged = repeatKeys[k].isCharged;
+        state.repeatKeys[k].nextIn = repeatKeys[k].nextTime - now;
+    }
+    return true;
+}
+
+//puts the game into `state` taken from a game with the same map size, pool and blocks set,
+//the next startGame goes on from it. False, and the game is left as it was, for states it can't take.
+inline bool Game::restore(const GameState& state, double now) {
+    if (state.sizeY != GameMap->mapSizeY() || state.sizeX != GameMap->mapSizeX() || state.poolSize != GameBlocks->blocksPoolSize
+        || state.currentLevel >= this->scoreProgressionLevels || state.garbageIn > state.sizeY)return false;
+    //slot 0 is refilled before it is used and stays empty until the first spawn
+    for (int k = 0; k < state.poolSize; k++) {
+        if (state.pool[k] < (k == 0 ? -1 : 0) || state.pool[k] >= (int)GameBlocks->countOfBlocks)return false;
+    }
+    if (state.fallingBlock < -1 || state.fallingBlock >= (int)GameBlocks->countOfBlocks || (state.fallingBlock >= 0
+        && (state.fallingForm < 0 || state.fallingForm >= GameBlocks->formsOf(state.fallingBlock))))return false;
+    if (now < 0)now = inputClockMS();
+
+    char field[GameState::maxRows * GameState::maxColumns];
+    int top = state.sizeY;
+    for (int k = 0, symbol; k < state.sizeY * state.sizeX; k++) {
+        symbol = (state.cells[k / 2] >> (k % 2 * 4)) & 0xF;
+        if (symbol > GameMap->symbolsCount)return false;
+        field[k] = (symbol == 0) ? ' ' : GameMap->symbols[symbol - 1];
+        if (symbol != 0 && top == state.sizeY)top = k / state.sizeX;
+    }
+    //rows above highestPoint are empty, checkStreak and insertGarbage rely on it
+    if (state.highestPoint > top)return false;
+    //the falling block has to fit the field like Map::canChange checks it
+    auto block = GameBlocks->formAt(state.fallingBlock, state.fallingForm);
+    if (block != nullptr && !state.isGameOver) {
+        if (state.fallingPosY + block->sizeY > state.sizeY || state.fallingPosX + block->sizeX > state.sizeX)return false;
+        for (int y = 0, x; y < block->sizeY; y++) {
+            for (x = 0; x < block->sizeX; x++) {
+                if (block->arr[y][x] != ' ' && field[(state.fallingPosY + y) * state.sizeX + state.fallingPosX + x] != ' ')return false;
+            }
+        }
+    }
+
+    GameBlocks->resetBlocks();
+    GameMap->clearedRows = 0;
+    GameMap->loadField(field);
+    GameMap->highestPoint = state.highestPoint;
+    for (int k = 0; k < state.poolSize; k++)GameBlocks->blocksPool[k] = (*GameBlocks)[state.pool[k]];
+    GameBlocks->fallingBlock = block;
+    GameBlocks->fallingBlockPosY = state.fallingPosY;
+    GameBlocks->fallingBlockPosX = state.fallingPosX;
+
+    this->prevBlock = state.prevBlock;
+    this->currentLevel = state.currentLevel;
+    this->refreshIntevalMS = scoreProgression[this->currentLevel];
+    this->isSeted = state.isSeted;
+    this->isPaused = state.isPaused;
+    this->isGameOver = state.isGameOver;
+    this->heldButtons = state.heldButtons;
+    this->garbageIn = state.garbageIn;
+    this->garbageOut = 0;
+    this->randomState = state.randomState;
+    this->score = state.score;
+    this->pauseTime = now - state.pausedFor;
+    this->gravityTime = (this->isPaused ? this->pauseTime : now) - state.gravityElapsed;
+    for (int k = 0; k < 3; k++) {
+        repeatKeys[k].isHeld = state.repeatKeys[k].isHeld;
+        repeatKeys[k].isCharged = state.repeatKeys[k].isCharged;
+        repeatKeys[k].nextTime = now + state.repeatKeys[k].nextIn;
+    }
+    this->isResumed = true;
+
+    if (block != nullptr && !this->isGameOver) {
+        GameBlocks->updateGhost();
+        GameMap->changeMap(GameBlocks->fallingBlockPosY, GameBlocks->fallingBlockPosX, block->sizeY, block->sizeX, block->arr);
+    }
+    return true;
+}
+
+//snapshot straight into the writer's slot, the disk is left to its thread
+inline void Game::saveGame() {
+    if (this->saves == nullptr)return;
+    if (this->isGameOver) {
+        this->saves->discard();
+        return;
+    }
+
+    GameState& state = this->saves->stateSlot();
+    memset(&state, 0, sizeof(GameState));
+    if (snapshot(state))this->saves->post();
+}
+
+//next input that happened before `before`
+inline bool Game::nextInput(InputEvent& event, double before) {
+    if (this->inputEvents != nullptr) {
+        if (!this->inputEvents->peek(event) || event.time >= before)return false;
+        return this->inputEvents->pop(event);
+    }
+
+    SDL_Event sdlEvent;
+    while (SDL_PollEvent(&sdlEvent)) {
+        if (toInputEvent(sdlEvent, event, inputClockMS()))return true;
+    }
+    return false;
+}
+
+//sleeps until the next input or `until`, -1 waits for the input only.
+//Polling SDL waits on its event queue, which it checks only every few ms.
+inline void Game::waitInput(double until) {
+    if (until < 0) {
+        if (this->inputReady == NULL)SDL_WaitEvent(NULL);
+        else SDL_SemWait(this->inputReady);
+        return;
+    }
+
+    double left = until - inputClockMS();
+    if (left <= 0)return;
+    if (this->inputReady == NULL)SDL_WaitEventTimeout(NULL, (int)left + 1);
+    else SDL_SemWaitTimeout(this->inputReady, (Uint32)left + 1);
+}
+
+inline int Game::repeatKeyOf(SDL_Keycode key) {
+    switch (key) {
+    case SDLK_LEFT:
+    case SDLK_a:
+        return repeatLeft;
+    case SDLK_RIGHT:
+    case SDLK_d:
+        return repeatRight;
+    case SDLK_DOWN:
+    case SDLK_s:
+        return repeatDown;
+    }
+    return -1;
+}
+
+//key went down at `time`, the press itself already moved once; the newer of left/right wins
+inline void Game::holdKey(int key, double time) {
+    repeatKeys[key].isHeld = true;
+    repeatKeys[key].isCharged = false;
+    repeatKeys[key].nextTime = time + ((key == repeatDown) ? softDropMS : dasMS);
+    if (key == repeatLeft)repeatKeys[repeatRight].isHeld = false;
+    if (key == repeatRight)repeatKeys[repeatLeft].isHeld = false;
+}
+
+//repeats of `key` due by `now`, 0xFFFF (any wall) for a zero rate
+inline int Game::repeatSteps(int key, double now) {
+    RepeatKey& repeat = repeatKeys[key];
+    if (!repeat.isHeld || now < repeat.nextTime)return 0;
+
+    repeat.isCharged = true;
+    if (repeatRate(key) <= 0) {
+        repeat.nextTime = now;
+        return 0xFFFF;
+    }
+    int steps = (int)((now - repeat.nextTime) / repeatRate(key)) + 1;
+    repeat.nextTime += steps * repeatRate(key);
+    return steps;
+}
+
+//earliest of `until` and the next repeat; charged zero rate keys only sweep again after other moves
+inline double Game::nextRepeatTime(double until) {
+    for (int k = 0; k < 3; k++) {
+        if (!repeatKeys[k].isHeld || (repeatKeys[k].isCharged && repeatRate(k) <= 0))continue;
+        until = std::min(until, repeatKeys[k].nextTime);
+    }
+    return until;
+}
+
+//creating pool of next blocks(for test k = 0,realese = 1)
+inline void Game::fillPool() {
+    for (int k = 1; k < GameBlocks->blocksPoolSize; k++) {
+        GameBlocks->blocksPool[k] = (*GameBlocks)[randomBlock()];
+    }
+}
+
+//level and pool of a new game, its first block comes from nextBlock
+inline void Game::beginGame() {
+    GameMap->highestPoint = GameMap->mapSizeY();
+    currentLevel = 0;
+    this->refreshIntevalMS = scoreProgression[currentLevel];
+    fillPool();
+}
+
+//next block from the pool into the map, false when it doesn't fit (game over)
+inline bool Game::spawnBlock(double now) {
+    if (currentLevel < scoreProgressionLevels&& scoreTrigger[currentLevel] <= score) {
+        currentLevel++;
+        this->refreshIntevalMS = scoreProgression[currentLevel];
+    }
+
+    isSeted = false;
+
+    GameBlocks->blocksPool[0] = (*GameBlocks)[randomBlock()];
+
+    GameBlocks->renderBlockStrick();
+
+    GameBlocks->pickBlock(GameBlocks->blocksPool[GameBlocks->blocksPoolSize - 1]);
+
+    //shift blocksPool to right;
+    for (int k = GameBlocks->blocksPoolSize - 1; k > 0; --k) {
+        GameBlocks->blocksPool[k] = GameBlocks->blocksPool[k - 1];
+    }
+
+    gravityTime = now;
+    auto block = GameBlocks->fallingBlock;
+    if (!GameMap->canChange(GameBlocks->fallingBlockPosY, GameBlocks->fallingBlockPosX, block->sizeY, block->sizeX, block->arr))return false;
+    GameBlocks->updateGhost();
+    GameMap->changeMap(GameBlocks->fallingBlockPosY, GameBlocks->fallingBlockPosX, block->sizeY, block->sizeX, block->arr);
+    return true;
+}
+
+//the landed block becomes part of the map, returns the lines it cleared;
+//cleared lines cancel pending garbage first, the rest is sent to the other player
+inline int Game::lockBlock() {
+    static const int garbageLines[5]{ 0, 0, 1, 2, 4 };
+    GameBlocks->clearGhost();
+    GameMap->settleBlock(GameBlocks->fallingBlockPosY, GameBlocks->fallingBlockPosX, GameBlocks->fallingBlock->sizeY, GameBlocks->fallingBlock->sizeX, GameBlocks->fallingBlock->arr);
+
+    this->score += 16 * (currentLevel / 2 + 1);
+    int linesErased = GameMap->checkStreak();
+    if (linesErased > 0)this->clearSequence++;
+    this->score += linesErased * 160 * (currentLevel / 2 + 1);
+
+    int sent = garbageLines[std::min(linesErased, 4)], cancelled = std::min(sent, this->garbageIn);
+    this->garbageIn -= cancelled;
+    this->garbageOut += sent - cancelled;
+
+    renderNums(1);
+    GameMap->renderField(1);
+    return linesErased;
+}
+
+//pending garbage under the stack, open at one column picked from the random state;
+//false when it pushes the stack out of the top
+inline bool Game::insertGarbage() {
+    if (this->garbageIn == 0)return true;
+    int rows = this->garbageIn, hole = (int)((randomState * 2654435761u) >> 16) % GameMap->mapSizeX();
+    this->garbageIn = 0;
+    return GameMap->insertGarbage(rows, hole);
+}
+
+//pending garbage under the stack, then the next block; false is game over
+inline bool Game::nextBlock(double now) {
+    return insertGarbage() && spawnBlock(now);
+}
+
+//one step inside the walls, it delays gravity even when the stack stops it
+inline void Game::shiftBy(int stepY, int stepX) {
+    int posX = GameBlocks->fallingBlockPosX + stepX;
+    if (posX < 0 || posX + GameBlocks->fallingBlock->sizeX > GameMap->mapSizeX())return;
+    GameBlocks->moveBlock(GameBlocks->fallingBlockPosY + stepY, posX);
+    gravityTime += moveDelay();
+    isSeted = false;
+}
+
+//moves of `buttons` pressed at `time`; true when buttonDrop landed and locked the block,
+//the caller goes on with nextBlock then
+inline bool Game::pressButtons(Uint8 buttons, double time) {
+    if (buttons & buttonRotate) {
+        GameBlocks->changeForm();
+        gravityTime += moveDelay();
+        isSeted = false;
+    }
+    if (buttons & buttonDown) {
+        holdKey(repeatDown, time);
+        shiftBy(1, 0);
+    }
+    if (buttons & buttonLeft) {
+        holdKey(repeatLeft, time);
+        shiftBy(0, -1);
+    }
+    if (buttons & buttonRight) {
+        holdKey(repeatRight, time);
+        shiftBy(0, 1);
+    }
+    //locks at once, held repeats must not slide the landed block
+    if (buttons & buttonDrop) {
+        GameBlocks->hardDrop();
+        lockBlock();
+        return true;
+    }
+    return false;
+}
+
+//held keys due by `now`, several due repeats are one sweep; true when the block moved
+inline bool Game::applyRepeats(double now) {
+    static const int repeatStepY[3]{ 0, 0, 1 }, repeatStepX[3]{ -1, 1, 0 };
+    bool isMoved = false;
+    for (int k = 0, steps; k < 3; k++) {
+        steps = repeatSteps(k, now);
+        if (steps > 0 && GameBlocks->shiftBlock(repeatStepY[k], repeatStepX[k], steps) > 0) {
+            gravityTime += moveDelay();
+            isSeted = false;
+            isMoved = true;
+        }
+    }
+    return isMoved;
+}
+
+//due gravity step at `now`: the block falls one row, or locks when it couldn't fall the last time;
+//true when it locked, the caller goes on with nextBlock then
+inline bool Game::gravityStep(double now) {
+    if (isSeted) {
+        lockBlock();
+        return true;
+    }
+    if (!GameBlocks->moveBlock(GameBlocks->fallingBlockPosY + 1, GameBlocks->fallingBlockPosX))isSeted = true;
+    gravityTime = now;
+    return false;
+}
+
+//One fixed step of the game at `now` with `buttons` (Buttons) held during it, the rules of startGame
+//without clock or SDL input: the same buttons at the same times give the same game on every machine.
+//Keep `now` in whole ms, so snapshot/restore of the timers is exact.
+inline void Game::stepFrame(Uint8 buttons, double now) {
+    if (this->isGameOver)return;
+
+    if (GameBlocks->fallingBlock == nullptr) {
+        beginGame();
+        if (!nextBlock(now)) {
+            this->isGameOver = true;
+            return;
+        }
+    }
+
+    //Buttons bits of left, right and down are in RepeatKeys order
+    Uint8 pressed = buttons & ~this->heldButtons;
+    for (int k = 0; k < 3; k++)if (!(buttons & (1 << k)))repeatKeys[k].isHeld = false;
+    this->heldButtons = buttons;
+
+    if (!pressButtons(pressed, now)) {
+        applyRepeats(now);
+        if (now < nextGravityTime() || !gravityStep(now))return;
+    }
+    if (!nextBlock(now))this->isGameOver = true;
+}
+
+//whole picture of a game driven by stepFrame, for targets drawn from the simulation
+inline void Game::renderGame() {
+    GameMap->renderField(0);
+    renderNums(0);
+    renderNums(1);
+    if (GameBlocks->blocksPool[1] != nullptr)GameBlocks->renderBlockStrick(0, 1);
+}
+
+inline void Game::startGame() {
+    //
+    bool isInput, isPlaced;
+    SDL_bool run = SDL_TRUE;
+    InputEvent event;
+    //
+restart:
+    if (!this->isResumed)beginGame();
+
+    GameMap->renderField(0);
+    renderNums(0);
+    if (this->score > 0)renderNums(1);
+    if (this->isPaused)GameMap->renderCover();
+
+    for (; run;) {
+    start:
+        //a restored block is already in the map
+        if (this->isResumed && GameBlocks->fallingBlock != nullptr) {
+            this->isResumed = false;
+            isPlaced = !this->isGameOver;
+            GameBlocks->renderBlockStrick(0, 1);
+        }
+        else {
+            this->isResumed = false;
+            isPlaced = nextBlock(inputClockMS());
+        }
+
+        if (isPlaced) {
+            publishFrame();
+            saveGame();
+            for (; run;) {
+
+                //inputs from before the next gravity step go first, later ones wait for it
+                for (isInput = false; nextInput(event, this->isPaused ? inputClockMS() + 1 : nextGravityTime());) {
+                    if (event.type == inputQuit) {
+                        run = SDL_FALSE;
+                    }
+                    //only p and escape work while paused, the gravity clock moves on by the paused time
+                    else if (this->isPaused) {
+                        if (event.type == inputKeyDown && !event.isRepeat && event.key == SDLK_p) {
+                            this->isPaused = false;
+                            gravityTime += event.time - pauseTime;
+                            GameMap->renderField(0);
+                            isInput = true;
+                        }
+                        else if (event.type == inputKeyDown && event.key == SDLK_ESCAPE)run = SDL_FALSE;
+                    }
+                    else if (event.type == inputKeyUp && repeatKeyOf(event.key) >= 0) {
+                        repeatKeys[repeatKeyOf(event.key)].isHeld = false;
+                    }
+                    //OS key repeat is replaced by the repeats below
+                    else if (event.type == inputKeyDown && !event.isRepeat) {
+                        isInput = true;
+                        //a hard drop locks at once, later inputs and held repeats go to the next block
+                        if (pressButtons(buttonOf(event.key), event.time))goto start;
+                        switch (event.key) {
+
+                        case SDLK_p:
+                            this->isPaused = true;
+                            pauseTime = event.time;
+                            for (int k = 0; k < 3; k++)repeatKeys[k].isHeld = false;
+                            GameMap->renderCover();
+                            saveGame();
+                            break;
+
+                        case SDLK_ESCAPE:
+                            run = SDL_FALSE;
+                            break;
+                        }
+
+                    }
+                }
+
+                if (this->isPaused) {
+                    if (isInput)publishFrame();
+                    waitInput();
+                    continue;
+                }
+
+                if (applyRepeats(inputClockMS()))isInput = true;
+                if (isInput)publishFrame();
+
+                if (nextGravityTime() <= inputClockMS()) {
+                    if (gravityStep(inputClockMS()))goto start;
+                    if (!isSeted)publishFrame();
+                }
+                else waitInput(nextRepeatTime(nextGravityTime()));
+
+            }
+        }
+        else {
+            //results stay on screen until r/enter starts over in place or escape quits
+            this->isGameOver = true;
+            GameMap->renderResults();
+            publishFrame();
+            saveGame();
+            while (run) {
+                while (run && nextInput(event, inputClockMS() + 1)) {
+                    if (event.type == inputQuit || (event.type == inputKeyDown && event.key == SDLK_ESCAPE))run = SDL_FALSE;
+                    else if (event.type == inputKeyDown && !event.isRepeat && (event.key == SDLK_r || event.key == SDLK_RETURN)) {
+                        resetGame();
+                        goto restart;
+                    }
+                }
+                if (run)waitInput();
+            }
+        }
+    }
+    saveGame();
+}
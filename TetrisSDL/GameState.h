@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <SDL.h>
+
+//Complete state of one game, see Game::snapshot and Game::restore. Plain data of fixed size,
+//copied with memcpy: checkpoints, rewinding, clones for search, rollback.
+//Board cells are packed two per byte as symbol index + 1 (0 - empty), the falling block and its
+//ghost are not part of it. Times are kept relative to the moment of the snapshot.
+struct GameState {
+    static const int maxRows = 32, maxColumns = 16, maxPool = 8;
+    struct RepeatKey {
+        bool isHeld;
+        bool isCharged;
+        double nextIn;//ms from the snapshot to the next repeat
+    };
+
+    Uint8 sizeY, sizeX;
+    Uint8 highestPoint;
+    Uint8 poolSize;
+    Sint8 pool[maxPool];//Blocks indices of blocksPool, -1 for empty slots
+    Sint8 fallingBlock, fallingForm;//Blocks index and form of the falling block, -1 for none
+    Uint8 fallingPosY, fallingPosX;
+    Sint8 prevBlock;
+    Uint8 currentLevel;
+    bool isSeted;//falling block landed and locks on the next gravity step
+    bool isPaused;
+    bool isGameOver;
+    Uint8 heldButtons;//see Game::stepFrame
+    Uint8 garbageIn;//rows sent by the other player, inserted under the stack when the falling block locks
+    Uint32 randomState;
+    Sint32 score;
+    double gravityElapsed;//ms since the last gravity step, paused time excluded
+    double pausedFor;//ms since the pause began
+    RepeatKey repeatKeys[3];
+    Uint8 cells[maxRows * maxColumns / 2];
+};
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <SDL.h>
+#include "SpscQueue.h"
+
+enum InputType {
+    inputKeyDown = 0,
+    inputKeyUp = 1,
+    inputQuit = 2
+};
+
+//Keyboard/quit event as the simulation sees it, time is in milliseconds of inputClockMS
+struct InputEvent {
+    double time = 0;
+    int type = inputKeyDown;
+    SDL_Keycode key = 0;
+    bool isRepeat = false;//OS key repeat
+};
+
+typedef SpscQueue<InputEvent, 256> InputQueue;
+
+//buttons held during one Game::stepFrame
+enum Buttons {
+    buttonLeft = 1,
+    buttonRight = 2,
+    buttonDown = 4,
+    buttonRotate = 8,
+    buttonDrop = 16
+};
+
+//same keys as Game::startGame, 0 for keys without a button
+inline Uint8 buttonOf(SDL_Keycode key) {
+    switch (key) {
+    case SDLK_LEFT:
+    case SDLK_a:
+        return buttonLeft;
+    case SDLK_RIGHT:
+    case SDLK_d:
+        return buttonRight;
+    case SDLK_DOWN:
+    case SDLK_s:
+        return buttonDown;
+    case SDLK_UP:
+    case SDLK_w:
+        return buttonRotate;
+    case SDLK_SPACE:
+        return buttonDrop;
+    }
+    return 0;
+}
+
+//high resolution clock shared by input timestamps and the game loop
+inline double inputClockMS() {
+    static const double frequency = (double)SDL_GetPerformanceFrequency();
+    return(SDL_GetPerformanceCounter() * 1000.0 / frequency);
+}
+
+//false for events the game doesn't handle
+inline bool toInputEvent(const SDL_Event& event, InputEvent& input, double time) {
+    input.time = time;
+    input.key = 0;
+    input.isRepeat = false;
+    if (event.type == SDL_QUIT)input.type = inputQuit;
+    else if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+        input.type = (event.type == SDL_KEYDOWN) ? inputKeyDown : inputKeyUp;
+        input.key = event.key.keysym.sym;
+        input.isRepeat = event.key.repeat != 0;
+    }
+    else return false;
+    return true;
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+#include <atomic>
+#include <SDL.h>
+#include "Game.h"
+#include "InputEvent.h"
+#include "SpscQueue.h"
+
+//SDL only pumps events on the thread that created the window, so the input thread is the calling one:
+//run() moves the game loop to a new thread and keeps this one polling the keyboard,
+//stamping every event with inputClockMS as it arrives.
+class InputThread {
+    InputQueue events;
+    SDL_sem* eventsReady = NULL;
+    std::atomic<bool> isFinished{ false };
+    Game* game = nullptr;
+    void (*gameLoop)(void* data) = nullptr;//runs instead of startGame (versus)
+    void* gameLoopData = nullptr;
+
+    static int gameMain(void* data);
+public:
+    bool run(Game& game, void (*gameLoop)(void* data) = nullptr, void* gameLoopData = nullptr);
+
+    ~InputThread() {
+        if (this->eventsReady != NULL)SDL_DestroySemaphore(this->eventsReady);
+    }
+};
+
+inline int InputThread::gameMain(void* data) {
+    InputThread* self = static_cast<InputThread*>(data);
+    if (self->gameLoop != nullptr)self->gameLoop(self->gameLoopData);
+    else self->game->startGame();
+    self->isFinished = true;
+    return 0;
+}
+
+//returns once the game is over, false when the game thread couldn't start (game is left untouched)
+inline bool InputThread::run(Game& game, void (*gameLoop)(void* data), void* gameLoopData) {
+    this->game = &game;
+    this->gameLoop = gameLoop;
+    this->gameLoopData = gameLoopData;
+    this->eventsReady = SDL_CreateSemaphore(0);
+    if (this->eventsReady == NULL)return false;
+    game.inputEvents = &this->events;
+    game.inputReady = this->eventsReady;
+
+    SDL_Thread* thread = SDL_CreateThread(gameMain, "game", this);
+    if (thread == NULL) {
+        game.inputEvents = nullptr;
+        game.inputReady = NULL;
+        return false;
+    }
+
+    SDL_Event sdlEvent;
+    InputEvent event;
+    while (!this->isFinished) {
+        //SDL_WaitEvent sleeps 10ms between polls in this SDL version, 1ms keeps timestamps tight
+        SDL_PumpEvents();
+        while (SDL_PollEvent(&sdlEvent)) {
+            if (toInputEvent(sdlEvent, event, inputClockMS()) && this->events.push(event))SDL_SemPost(this->eventsReady);
+        }
+        SDL_Delay(1);
+    }
+
+    SDL_WaitThread(thread, NULL);
+    game.inputEvents = nullptr;
+    game.inputReady = NULL;
+    return true;
+}
@@ -0,0 +1,405 @@
+﻿#pragma once
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <SDL.h>
+#include "SquareMatrixData.h"
+#include "RenderTarget.h"
+#include "Arena.h"
+
+class Map {
+    unsigned short int SizeY;
+    unsigned short int SizeX;
+    char** field;//current render
+    char** fieldPrev;//previous render (for quick segments change)
+    bool* dirtyRows;//rows where field may differ from fieldPrev
+    //board features, kept up to date by every write to field (see writeCell and updateColumn)
+    int* rowFills;//filled cells of every row, the falling block included
+    int* columnTops;//first solid row of every column without the falling block, SizeY for empty ones
+    int* columnHoleCounts;//empty cells under the column top
+    int holesCount = 0;
+
+    bool isFilled(char a) { return a != ' ' && a != ghostSymbol; }
+    void writeCell(int y, int x, char a) {
+        rowFills[y] += isFilled(a) - isFilled(field[y][x]);
+        field[y][x] = a;
+    }
+public:
+    int highestPoint = 0;
+    bool isChanged = true;
+    char ghostSymbol = 0;//landing preview of the falling block, passable like empty cells; 0 - no ghost
+    Uint32 clearedRows = 0;//rows removed by the last checkStreak (first 32), for renderers running apart from the map
+    //
+    int symbolsCount = 0;
+    char* symbols = nullptr;
+    int* symbolsColors = nullptr;
+    int symbolsIndex[256];//symbol -> position in symbols, -1 for empty and unknown ones
+    std::vector<Uint32> symbolsPixels;//symbolsColors mapped for target
+    Uint32 backgroundPixel = 0, squarePixel = 0, flashPixel = 0;
+    RenderTarget* mappedTarget = NULL;
+    std::vector<std::vector<SDL_Rect>> colorBatches;//rects of one pass: empty squares, frames, then one per symbol
+    //
+    SquareMatrixData* mapMatrix = NULL;
+    RenderLayer* backgroundLayer = NULL;//empty grid, see renderBackground
+    //
+    RenderTarget* target = NULL;
+    //
+    Map(int sizeY, int sizeX) :
+        SizeY(sizeY),
+        SizeX(sizeX)
+    {
+
+        field = arenaArray<char*>(sizeY);
+        fieldPrev = arenaArray<char*>(sizeY);
+        dirtyRows = arenaArray<bool>(sizeY);
+        rowFills = arenaArray<int>(sizeY);
+        columnTops = arenaArray<int>(sizeX);
+        columnHoleCounts = arenaArray<int>(sizeX);
+        for (int x = 0; x < sizeX; x++) {
+            columnTops[x] = sizeY;
+            columnHoleCounts[x] = 0;
+        }
+        for (int k = 0; k < 256; k++)symbolsIndex[k] = -1;
+        for (int y = 0, x; y < sizeY; y++) {
+            dirtyRows[y] = false;
+            rowFills[y] = 0;
+            field[y] = arenaArray<char>(sizeX);
+            fieldPrev[y] = arenaArray<char>(sizeX);
+            for (x = 0; x < sizeX; x++) {
+                field[y][x] = ' ';
+                fieldPrev[y][x] = ' ';
+            }
+        }
+    }
+    int mapSizeY() { return SizeY; }
+    int mapSizeX() { return SizeX; }
+    char getCell(int y, int x) { return field[y][x]; }
+    void setCell(int y, int x, char a);
+    bool isSolid(char a) { return a != ' ' && a != ghostSymbol; }
+    int rowFill(int y) { return rowFills[y]; }
+    int columnTop(int x) { return columnTops[x]; }
+    int columnHeight(int x) { return SizeY - columnTops[x]; }
+    int columnHoles(int x) { return columnHoleCounts[x]; }
+    int holes() { return holesCount; }
+    int wellDepth(int x);
+    void settleBlock(int posY, int posX, int sizeY, int sizeX, char** arr);
+    void updateColumn(int x);
+    void updateFeatures();
+    void markRows(int from, int to);
+    void saveField(char* buffer);
+    void loadField(const char* buffer);
+    int getSymbolNum(char a) { return symbolsIndex[(unsigned char)a]; }
+    Uint32 getSymbolPixel(char a) { return symbolsPixels[symbolsIndex[(unsigned char)a]]; }
+    void updateSymbols();
+    void mapColors();
+    void renderBackground();
+    void renderField(int type);
+    void renderCover();
+    void renderResults();
+    void clearField();
+    int canChange(int posY, int posX, int sizeY, int sizeX, char** arr, int permission);
+    int changeMap(int posY, int posX, int sizeY, int sizeX, char** arr, bool type);
+    int checkStreak();
+    bool insertGarbage(int rows, int hole);
+};
+
+//rebuilds the lookup tables, call after changing symbols or symbolsColors
+inline void Map::updateSymbols() {
+    for (int k = 0; k < 256; k++)symbolsIndex[k] = -1;
+    for (int k = 0; k < symbolsCount; k++)symbolsIndex[(unsigned char)symbols[k]] = k;
+
+    symbolsPixels.assign(symbolsColors, symbolsColors + symbolsCount);
+    colorBatches.resize(symbolsCount + 2);
+    mappedTarget = NULL;
+}
+
+//maps colors to the target pixel format once, not per drawn cell
+inline void Map::mapColors() {
+    if (this->mappedTarget == this->target || this->target == NULL)return;
+
+    for (int k = 0; k < symbolsCount; k++)symbolsPixels[k] = this->target->mapColor(symbolsColors[k]);
+    this->backgroundPixel = this->target->mapColor(this->mapMatrix->backgroundColorRGB);
+    this->squarePixel = this->target->mapColor(this->mapMatrix->squareColorRGB);
+    this->flashPixel = this->target->mapColor(0xFFFFFF);
+    this->mappedTarget = this->target;
+}
+
+//buffer must hold SizeY * SizeX symbols
+inline void Map::saveField(char* buffer) {
+    for (int y = 0; y < this->SizeY; y++, buffer += this->SizeX)memcpy(buffer, field[y], this->SizeX);
+}
+
+inline void Map::loadField(const char* buffer) {
+    for (int y = 0; y < this->SizeY; y++, buffer += this->SizeX)memcpy(field[y], buffer, this->SizeX);
+    markRows(0, this->SizeY);
+    updateFeatures();
+    this->isChanged = true;
+}
+
+inline void Map::setCell(int y, int x, char a) {
+    bool wasSolid = isSolid(field[y][x]);
+    writeCell(y, x, a);
+    dirtyRows[y] = true;
+    if (wasSolid != isSolid(a))updateColumn(x);
+}
+
+//depth of the gap between the column and its lower neighbour (walls count as full), 0 for no well
+inline int Map::wellDepth(int x) {
+    int left = (x > 0) ? columnHeight(x - 1) : this->SizeY;
+    int right = (x + 1 < this->SizeX) ? columnHeight(x + 1) : this->SizeY;
+    return std::max(std::min(left, right) - columnHeight(x), 0);
+}
+
+//the block placed with changeMap stays: column features and highestPoint include it from now on
+inline void Map::settleBlock(int posY, int posX, int sizeY, int sizeX, char** arr) {
+    for (int x = 0, y; x < sizeX; x++) {
+        for (y = 0; y < sizeY && arr[y][x] == ' '; y++);
+        if (y < sizeY)updateColumn(posX + x);
+    }
+    if (posY < this->highestPoint)this->highestPoint = posY;
+}
+
+//top and holes of one column, O(SizeY)
+inline void Map::updateColumn(int x) {
+    int y = 0, holes = 0;
+    for (; y < this->SizeY && !isSolid(field[y][x]); y++);
+    columnTops[x] = y;
+    for (; y < this->SizeY; y++)if (!isSolid(field[y][x]))holes++;
+
+    this->holesCount += holes - columnHoleCounts[x];
+    columnHoleCounts[x] = holes;
+}
+
+//every feature from the whole field, after loadField
+inline void Map::updateFeatures() {
+    for (int y = 0, x; y < this->SizeY; y++) {
+        for (rowFills[y] = 0, x = 0; x < this->SizeX; x++)rowFills[y] += isFilled(field[y][x]);
+    }
+    for (int x = 0; x < this->SizeX; x++)updateColumn(x);
+}
+
+//marks rows [from, to) for the next incremental render
+inline void Map::markRows(int from, int to) {
+    for (int y = (from < 0) ? 0 : from; y < to && y < this->SizeY; y++)dirtyRows[y] = true;
+}
+
+//pre-renders the empty grid once, so a full redraw is one copy plus the occupied cells
+inline void Map::renderBackground() {
+    static SDL_Rect* rect = nullptr;
+
+    if (this->backgroundLayer == NULL)this->backgroundLayer = new RenderLayer;
+    this->backgroundLayer->createLayer(this->mapMatrix->backgroundRect);
+    this->backgroundLayer->fillRect(this->mapMatrix->backgroundRect, this->mapMatrix->backgroundColorRGB);
+
+    for (int y = 0, x; y < this->SizeY; y++) {
+        for (x = 0; x < this->SizeX; x++) {
+            rect = renderBorder(&this->mapMatrix->matrix[y][x], this->mapMatrix->horizontalPadding, this->mapMatrix->verticalPadding, this->mapMatrix->horizontalPadding, this->mapMatrix->verticalPadding);
+            this->backgroundLayer->fillRect(rect, this->mapMatrix->squareColorRGB);
+            delete rect;
+        }
+    }
+}
+
+inline void Map::renderField(int type = 1) {
+
+    //headless map (perft, server) has nothing to draw
+    if (this->target == NULL)return;
+    mapColors();
+
+    if (this->isChanged) {
+        //Re-render background
+
+        if (!type) {
+            if (this->backgroundLayer == NULL)renderBackground();
+            target->drawLayer(this->backgroundLayer);
+        }
+        //incremental render visits only dirty rows and draws only cells that differ from fieldPrev
+        for (int y = 0, x, symbol; y < this->SizeY; y++) {
+            if (type && !dirtyRows[y])continue;
+            dirtyRows[y] = false;
+
+            for (x = 0; x < this->SizeX; x++) {
+                if (type && field[y][x] == fieldPrev[y][x])continue;
+                fieldPrev[y][x] = field[y][x];
+
+                symbol = getSymbolNum(field[y][x]);
+                if (!type && symbol < 0)continue;//empty cells are already in the background layer
+
+                if (symbol < 0) {
+                    colorBatches[0].push_back(getBorder(&this->mapMatrix->matrix[y][x],
+                        ((x > 0 && this->field[y][x - 1] != ' ') ? 0 : this->mapMatrix->horizontalPadding),
+                        ((y > 0 && this->field[y - 1][x] != ' ') ? 0 : this->mapMatrix->verticalPadding),
+                        ((x + 1 < this->SizeX && this->field[y][x + 1] != ' ') ? 0 : this->mapMatrix->horizontalPadding),
+                        ((y + 1 < this->SizeY && this->field[y + 1][x] != ' ') ? 0 : this->mapMatrix->verticalPadding)
+                    ));
+                }
+                else {
+                    colorBatches[1].push_back(getBorder(&this->mapMatrix->matrix[y][x], this->mapMatrix->horizontalPadding, this->mapMatrix->verticalPadding, this->mapMatrix->horizontalPadding, this->mapMatrix->verticalPadding));
+                    colorBatches[2 + symbol].push_back(this->mapMatrix->matrix[y][x]);
+                }
+
+            }
+        }
+
+        //one fill per color; frames of occupied cells go over empty squares, cells over their frames
+        for (int k = 0; k < symbolsCount + 2; k++) {
+            if (colorBatches[k].empty())continue;
+            this->target->fillRects(colorBatches[k].data(), (int)colorBatches[k].size(), (k == 0) ? this->squarePixel : (k == 1) ? this->backgroundPixel : this->symbolsPixels[k - 2]);
+            colorBatches[k].clear();
+        }
+        this->isChanged = true;
+        target->present();
+    }
+}
+
+//empty grid over the whole field, hides the board while the game is paused; renderField(0) brings it back
+inline void Map::renderCover() {
+    if (this->target == NULL)return;
+
+    if (this->backgroundLayer == NULL)renderBackground();
+    target->drawLayer(this->backgroundLayer);
+    target->present();
+}
+
+//game over look: the stack in one color over the last picture, renderField(0) brings the colors back
+inline void Map::renderResults() {
+    if (this->target == NULL)return;
+
+    mapColors();
+    for (int y = this->highestPoint, x; y < this->SizeY; y++) {
+        for (x = 0; x < this->SizeX; x++)if (isSolid(field[y][x]))colorBatches[0].push_back(this->mapMatrix->matrix[y][x]);
+    }
+    this->target->fillRects(colorBatches[0].data(), (int)colorBatches[0].size(), this->flashPixel);
+    colorBatches[0].clear();
+    this->target->present();
+}
+
+//empties the field in place for a new game
+inline void Map::clearField() {
+    for (int y = 0; y < this->SizeY; y++) {
+        memset(field[y], ' ', this->SizeX);
+        rowFills[y] = 0;
+    }
+    for (int x = 0; x < this->SizeX; x++) {
+        columnTops[x] = this->SizeY;
+        columnHoleCounts[x] = 0;
+    }
+    this->holesCount = 0;
+    this->highestPoint = this->SizeY;
+    this->clearedRows = 0;
+    markRows(0, this->SizeY);
+    this->isChanged = true;
+}
+
+inline int Map::canChange(int posY, int posX, int sizeY, int sizeX, char** arr, int permission = 0) {
+    if (0 <= posY && 0 <= posX && posY + sizeY <= this->SizeY && posX + sizeX <= this->SizeX) {
+        for (int y = 0, x; y < sizeY; y++) {
+            for (x = 0; x < sizeX; x++)if (arr[y][x] != ' ' && isSolid(this->field[posY + y][posX + x]) && !permission)return 0;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+inline int Map::changeMap(int posY, int posX, int sizeY, int sizeX, char** arr = nullptr, bool type = 1) {
+    if (!type || this->canChange(posY, posX, sizeY, sizeX, arr)) {
+        markRows(posY, posY + sizeY);
+        for (int y = 0, x; y < sizeY; y++) {
+            for (x = 0; x < sizeX; x++) {
+                if (type) {
+                    if (arr[y][x] != ' ')writeCell(posY + y, posX + x, arr[y][x]);
+                }
+                else if (type == 0) {
+                    if (arr[y][x] != ' ')writeCell(posY + y, posX + x, ' ');
+                }
+            }
+        }
+        this->isChanged = true;
+        if (type) {
+            renderField();
+        }
+        return(1);
+    }
+    else return(0);
+}
+
+inline int Map::checkStreak() {
+    //declaring lambda nested function for blink animation
+    static void (*drawRectLine)(Map& obj, int y, int delayTime) = [](Map& obj, int y, int delayTime) {
+        obj.target->fillRects(obj.mapMatrix->matrix[y], obj.SizeX, obj.flashPixel);
+        obj.target->present();
+        SDL_Delay(delayTime);
+    };
+
+    int linesErased = 0;
+    this->clearedRows = 0;
+    for (int y = this->highestPoint, x; y < this->SizeY; y++) {
+        if (rowFills[y] == this->SizeX) {
+            linesErased++;
+            if (y < 32)this->clearedRows |= 1u << y;//rows above are shifted down, so y is the original row
+
+            //erasing animation start:
+            if (this->target != NULL) {
+                mapColors();
+                drawRectLine(*this, y, 100);
+
+                renderField(0);//can be optimized to just colorize only 1 erasings line
+                SDL_Delay(150);
+
+                drawRectLine(*this, y, 100);
+            }
+            //end:
+
+            markRows(0, y + 1);
+            if (y == 0) {
+                for (x = 0; x < this->SizeX; x++)field[y][x] = ' ';
+                rowFills[y] = 0;
+            }
+            else {
+                for (y--; y > -1; y--) {
+                    for (x = 0; x < this->SizeX; x++)field[y + 1][x] = field[y][x];
+                    rowFills[y + 1] = rowFills[y];
+                }
+            }
+            y = this->highestPoint++;
+
+            renderField(0);
+
+        }
+    }
+    if (linesErased > 0)for (int x = 0; x < this->SizeX; x++)updateColumn(x);
+    return(linesErased);
+}
+
+//Pushes the stack up by `rows` and fills the freed bottom rows with garbage ('p') open at `hole`.
+//Call it between locking a block and spawning the next one. Rows move as pointers, only the new
+//garbage cells are written and only the shifted rows are redrawn. False, and nothing changes,
+//when the stack would be pushed out of the top or `hole` is outside the field.
+inline bool Map::insertGarbage(int rows, int hole) {
+    if (hole < 0 || hole >= this->SizeX)return false;
+    if (rows <= 0)return true;
+    if (rows > this->highestPoint)return false;
+
+    //rows above highestPoint are empty, the top ones come back at the bottom as garbage
+    std::rotate(field, field + rows, field + this->SizeY);
+    std::rotate(rowFills, rowFills + rows, rowFills + this->SizeY);
+    for (int y = this->SizeY - rows; y < this->SizeY; y++) {
+        memset(field[y], 'p', this->SizeX);
+        field[y][hole] = ' ';
+        rowFills[y] = this->SizeX - 1;
+    }
+    for (int x = 0; x < this->SizeX; x++) {
+        if (columnTops[x] < this->SizeY)columnTops[x] -= rows;
+        else if (x != hole)columnTops[x] = this->SizeY - rows;
+        if (x == hole && columnTops[x] < this->SizeY) {
+            columnHoleCounts[x] += rows;
+            this->holesCount += rows;
+        }
+    }
+    this->highestPoint -= rows;
+
+    markRows(this->highestPoint, this->SizeY);
+    this->isChanged = true;
+    renderField();
+    return true;
+}
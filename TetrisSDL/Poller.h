@@ -0,0 +1,176 @@
+﻿#pragma once
+#include <vector>
+#include <unordered_map>
+#include <SDL.h>
+#include "Sockets.h"
+#if defined(__linux__)
+#include <sys/epoll.h>
+#elif !defined(_WIN32)
+#include <poll.h>
+#endif
+
+enum PollFlags {
+    pollRead = 1,
+    pollWrite = 2,
+    pollClosed = 4//hang-up or error, reading tells which
+};
+
+struct PollEvent {
+    void* data;//what the socket was added with
+    int flags;//PollFlags that happened
+};
+
+//Readiness of many non-blocking sockets at once: epoll on Linux, WSAPoll on Windows, poll elsewhere.
+//Level-triggered everywhere, so a socket stays ready until it was read or written out.
+//One thread uses a poller; wait costs O(ready sockets) with epoll and O(sockets) with (WSA)poll.
+class Poller {
+#if defined(__linux__)
+    int handle = -1;
+    std::vector<epoll_event> ready;
+#else
+#ifdef _WIN32
+    typedef WSAPOLLFD PollSocket;
+#else
+    typedef pollfd PollSocket;
+#endif
+    std::vector<PollSocket> sockets;
+    std::vector<void*> datas;
+    std::unordered_map<SocketHandle, size_t> positions;//socket -> index in sockets
+    bool isOpen = false;
+#endif
+public:
+    bool open();
+    bool add(SocketHandle socket, void* data, int flags = pollRead);
+    bool modify(SocketHandle socket, void* data, int flags);
+    void remove(SocketHandle socket);
+    int wait(PollEvent* events, int maxEvents, int timeoutMS);
+    void close();
+
+    ~Poller() {
+        close();
+    }
+};
+
+#if defined(__linux__)
+
+inline bool Poller::open() {
+    close();
+    this->handle = epoll_create1(0);
+    return(this->handle >= 0);
+}
+
+inline bool Poller::add(SocketHandle socket, void* data, int flags) {
+    epoll_event event;
+    event.events = ((flags & pollRead) ? (Uint32)(EPOLLIN | EPOLLRDHUP) : 0) | ((flags & pollWrite) ? (Uint32)EPOLLOUT : 0);
+    event.data.ptr = data;
+    return(epoll_ctl(this->handle, EPOLL_CTL_ADD, socket, &event) == 0);
+}
+
+inline bool Poller::modify(SocketHandle socket, void* data, int flags) {
+    epoll_event event;
+    event.events = ((flags & pollRead) ? (Uint32)(EPOLLIN | EPOLLRDHUP) : 0) | ((flags & pollWrite) ? (Uint32)EPOLLOUT : 0);
+    event.data.ptr = data;
+    return(epoll_ctl(this->handle, EPOLL_CTL_MOD, socket, &event) == 0);
+}
+
+inline void Poller::remove(SocketHandle socket) {
+    epoll_event event;
+    epoll_ctl(this->handle, EPOLL_CTL_DEL, socket, &event);
+}
+
+//ready sockets, at most maxEvents of them; waits up to timeoutMS (-1 - forever) for the first one
+inline int Poller::wait(PollEvent* events, int maxEvents, int timeoutMS) {
+    if ((int)this->ready.size() < maxEvents)this->ready.resize(maxEvents);
+    int count = epoll_wait(this->handle, this->ready.data(), maxEvents, timeoutMS);
+    for (int k = 0; k < count; k++) {
+        Uint32 happened = this->ready[k].events;
+        events[k].data = this->ready[k].data.ptr;
+        events[k].flags = ((happened & EPOLLIN) ? pollRead : 0) | ((happened & EPOLLOUT) ? pollWrite : 0)
+            | ((happened & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) ? pollClosed : 0);
+    }
+    return(count < 0) ? 0 : count;
+}
+
+inline void Poller::close() {
+    if (this->handle >= 0)::close(this->handle);
+    this->handle = -1;
+}
+
+#else
+
+inline bool Poller::open() {
+    close();
+    this->isOpen = true;
+    return true;
+}
+
+inline bool Poller::add(SocketHandle socket, void* data, int flags) {
+    if (!this->isOpen || this->positions.count(socket) != 0)return false;
+
+    PollSocket entry;
+    entry.fd = socket;
+    entry.events = ((flags & pollRead) ? POLLRDNORM : 0) | ((flags & pollWrite) ? POLLWRNORM : 0);
+    entry.revents = 0;
+    this->positions[socket] = this->sockets.size();
+    this->sockets.push_back(entry);
+    this->datas.push_back(data);
+    return true;
+}
+
+inline bool Poller::modify(SocketHandle socket, void* data, int flags) {
+    auto position = this->positions.find(socket);
+    if (position == this->positions.end())return false;
+
+    this->sockets[position->second].events = ((flags & pollRead) ? POLLRDNORM : 0) | ((flags & pollWrite) ? POLLWRNORM : 0);
+    this->datas[position->second] = data;
+    return true;
+}
+
+//the last socket takes the freed place, so removing stays O(1)
+inline void Poller::remove(SocketHandle socket) {
+    auto position = this->positions.find(socket);
+    if (position == this->positions.end())return;
+
+    size_t index = position->second;
+    this->positions.erase(position);
+    if (index + 1 != this->sockets.size()) {
+        this->sockets[index] = this->sockets.back();
+        this->datas[index] = this->datas.back();
+        this->positions[this->sockets[index].fd] = index;
+    }
+    this->sockets.pop_back();
+    this->datas.pop_back();
+}
+
+inline int Poller::wait(PollEvent* events, int maxEvents, int timeoutMS) {
+    //WSAPoll refuses an empty set
+    if (this->sockets.empty()) {
+        if (timeoutMS > 0)SDL_Delay(timeoutMS);
+        return 0;
+    }
+#ifdef _WIN32
+    int found = WSAPoll(this->sockets.data(), (ULONG)this->sockets.size(), timeoutMS);
+#else
+    int found = poll(this->sockets.data(), (nfds_t)this->sockets.size(), timeoutMS);
+#endif
+
+    int count = 0;
+    for (size_t k = 0; k < this->sockets.size() && count < found && count < maxEvents; k++) {
+        short happened = this->sockets[k].revents;
+        if (happened == 0)continue;
+        events[count].data = this->datas[k];
+        events[count].flags = ((happened & POLLRDNORM) ? pollRead : 0) | ((happened & POLLWRNORM) ? pollWrite : 0)
+            | ((happened & (POLLHUP | POLLERR | POLLNVAL)) ? pollClosed : 0);
+        count++;
+    }
+    return count;
+}
+
+inline void Poller::close() {
+    this->sockets.clear();
+    this->datas.clear();
+    this->positions.clear();
+    this->isOpen = false;
+}
+
+#endif
@@ -0,0 +1,285 @@
+﻿#pragma once
+#include <vector>
+#include <SDL.h>
+#include "FillKernel.h"
+
+enum RenderBackend {
+    surfaceBackend = 0,//SDL_FillRect into an SDL_Surface
+    rendererBackend = 1//SDL_Renderer, rects batched per color
+};
+
+//rects of one color queued until the next present
+struct RenderBatch {
+    Uint32 color;
+    std::vector<SDL_Rect> rects;
+};
+
+//Static picture (empty grid, glyphs) drawn once and copied on every full redraw.
+//Layer surface is in 0xRRGGBB layout until the first drawLayer, rects passed to fillRect
+//are in target coordinates.
+struct RenderLayer {
+    SDL_Surface* surface = NULL;
+    SDL_Texture* texture = NULL;//uploaded copy for rendererBackend
+    SDL_Renderer* textureRenderer = NULL;
+    SDL_Rect rect;//where the layer is copied to
+
+    bool createLayer(const SDL_Rect* rect);
+    void freeLayer();
+    void fillRect(const SDL_Rect* rect, Uint32 color);
+
+    ~RenderLayer() {
+        freeLayer();
+    }
+};
+
+inline bool RenderLayer::createLayer(const SDL_Rect* rect) {
+    freeLayer();
+    this->rect = *rect;
+    this->surface = SDL_CreateRGBSurface(0, rect->w, rect->h, 32, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+    return(this->surface != NULL);
+}
+
+inline void RenderLayer::freeLayer() {
+    if (this->texture != NULL)SDL_DestroyTexture(this->texture);
+    SDL_FreeSurface(this->surface);
+    this->texture = NULL;
+    this->textureRenderer = NULL;
+    this->surface = NULL;
+}
+
+inline void RenderLayer::fillRect(const SDL_Rect* rect, Uint32 color) {
+    SDL_Rect local{ rect->x - this->rect.x, rect->y - this->rect.y, rect->w, rect->h };
+    SDL_FillRect(this->surface, &local, color);
+}
+
+//Surface the renderers draw into: the window surface, an offscreen SDL_Surface
+//or a raw 32-bit pixel buffer (headless rendering, golden images, spectator frames).
+//Offscreen targets don't need a video driver, so they also work under SDL_VIDEODRIVER=dummy.
+//
+//With rendererBackend every fill is queued and present() issues one SDL_RenderFillRects
+//per color into the canvas texture, which keeps the static layers between frames.
+//Overlapping rects of different colors are painted in the order the colors were first used.
+struct RenderTarget {
+    int backend = surfaceBackend;
+    SDL_Surface* surface = NULL;
+    SDL_Window* window = NULL;//window to present, NULL for offscreen targets
+    bool ownsSurface = false;
+    //rects up to this width go through fillRects32, wider ones through SDL_FillRect
+    //(SDL's fill wins once per-call overhead is amortized, see fill/* cases in TetrisBench)
+    int kernelMaxWidth = 64;
+    std::vector<SDL_Rect> narrowRects, wideRects;//fillRects split of mixed batches, kept between calls
+    //rendererBackend
+    SDL_Renderer* renderer = NULL;
+    SDL_Texture* canvas = NULL;
+    bool ownsRenderer = false;
+    std::vector<RenderBatch> batches;
+    int batchesCount = 0;
+
+    bool createFromWindow(SDL_Window* window);
+    bool createSurface(int sizeX, int sizeY);
+    bool createFromPixels(void* pixels, int sizeX, int sizeY, int pitch);
+    bool createFromRenderer(SDL_Renderer* renderer, SDL_Window* window, int sizeX, int sizeY);
+    bool createSoftwareRenderer(int sizeX, int sizeY);
+    bool createCanvas(int sizeX, int sizeY);
+    void freeTarget();
+
+    Uint32 mapColor(Uint32 color);
+    void fillRect(const SDL_Rect* rect, Uint32 color);
+    void fillRects(const SDL_Rect* rects, int count, Uint32 color);
+    void drawLayer(RenderLayer* layer, const SDL_Rect* source = NULL, const SDL_Rect* destination = NULL);
+    void flush();
+    void present();
+    bool saveBMP(const char* path);
+
+    ~RenderTarget() {
+        freeTarget();
+    }
+};
+
+inline bool RenderTarget::createFromWindow(SDL_Window* window) {
+    freeTarget();
+    this->window = window;
+    this->surface = SDL_GetWindowSurface(window);
+    return(this->surface != NULL);
+}
+
+//colors are passed around as 0xRRGGBB, so offscreen targets use the same layout
+inline bool RenderTarget::createSurface(int sizeX, int sizeY) {
+    freeTarget();
+    this->surface = SDL_CreateRGBSurface(0, sizeX, sizeY, 32, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+    this->ownsSurface = true;
+    return(this->surface != NULL);
+}
+
+inline bool RenderTarget::createFromPixels(void* pixels, int sizeX, int sizeY, int pitch) {
+    freeTarget();
+    this->surface = SDL_CreateRGBSurfaceFrom(pixels, sizeX, sizeY, 32, pitch, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+    this->ownsSurface = true;
+    return(this->surface != NULL);
+}
+
+//renderer stays owned by the caller (Window)
+inline bool RenderTarget::createFromRenderer(SDL_Renderer* renderer, SDL_Window* window, int sizeX, int sizeY) {
+    freeTarget();
+    this->backend = rendererBackend;
+    this->renderer = renderer;
+    this->window = window;
+    return createCanvas(sizeX, sizeY);
+}
+
+//software SDL_Renderer drawing into an offscreen surface, works without any GPU or window
+inline bool RenderTarget::createSoftwareRenderer(int sizeX, int sizeY) {
+    if (!createSurface(sizeX, sizeY))return false;
+
+    this->backend = rendererBackend;
+    this->renderer = SDL_CreateSoftwareRenderer(this->surface);
+    this->ownsRenderer = true;
+    return(this->renderer != NULL && createCanvas(sizeX, sizeY));
+}
+
+inline bool RenderTarget::createCanvas(int sizeX, int sizeY) {
+    this->canvas = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_TARGET, sizeX, sizeY);
+    if (this->canvas == NULL)return false;
+
+    SDL_SetRenderTarget(this->renderer, this->canvas);
+    SDL_SetRenderDrawColor(this->renderer, 0, 0, 0, 255);
+    SDL_RenderClear(this->renderer);
+    return true;
+}
+
+inline void RenderTarget::freeTarget() {
+    //window surface and window renderer belong to the window
+    if (this->canvas != NULL)SDL_DestroyTexture(this->canvas);
+    if (this->ownsRenderer && this->renderer != NULL)SDL_DestroyRenderer(this->renderer);
+    if (this->ownsSurface)SDL_FreeSurface(this->surface);
+    this->canvas = NULL;
+    this->renderer = NULL;
+    this->surface = NULL;
+    this->window = NULL;
+    this->ownsRenderer = false;
+    this->ownsSurface = false;
+    this->backend = surfaceBackend;
+    this->batchesCount = 0;
+}
+
+//0xRRGGBB to the pixel value fillRect expects: native surface format, or 0xRRGGBB for the renderer
+inline Uint32 RenderTarget::mapColor(Uint32 color) {
+    if (this->backend == surfaceBackend)return SDL_MapRGB(this->surface->format, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+    return color;
+}
+
+inline void RenderTarget::fillRect(const SDL_Rect* rect, Uint32 color) {
+    if (this->backend == surfaceBackend) {
+        if (rect != NULL && rect->w <= this->kernelMaxWidth && this->surface->format->BytesPerPixel == 4)fillRects32(this->surface, rect, 1, color);
+        else SDL_FillRect(this->surface, rect, color);
+        return;
+    }
+    fillRects(rect, 1, color);
+}
+
+inline void RenderTarget::fillRects(const SDL_Rect* rects, int count, Uint32 color) {
+    if (this->backend == surfaceBackend) {
+        if (this->surface->format->BytesPerPixel != 4) {
+            SDL_FillRects(this->surface, rects, count, color);
+            return;
+        }
+        //one kernel call for the narrow rects and one SDL_FillRects for the wide ones,
+        //so the surface is locked and clipped once per batch; batches of one kind aren't copied
+        int narrow = 0;
+        for (int k = 0; k < count; k++)narrow += rects[k].w <= this->kernelMaxWidth;
+        if (narrow == count)fillRects32(this->surface, rects, count, color);
+        else if (narrow == 0)SDL_FillRects(this->surface, rects, count, color);
+        else {
+            this->narrowRects.clear();
+            this->wideRects.clear();
+            for (int k = 0; k < count; k++)(rects[k].w <= this->kernelMaxWidth ? this->narrowRects : this->wideRects).push_back(rects[k]);
+            fillRects32(this->surface, this->narrowRects.data(), (int)this->narrowRects.size(), color);
+            SDL_FillRects(this->surface, this->wideRects.data(), (int)this->wideRects.size(), color);
+        }
+        return;
+    }
+
+    int k = 0;
+    for (; k < this->batchesCount && this->batches[k].color != color; k++);
+    if (k == this->batchesCount) {
+        //batches keep their vectors between frames, so steady state doesn't allocate
+        if (k == (int)this->batches.size())this->batches.push_back(RenderBatch{ color, {} });
+        this->batches[k].color = color;
+        this->batches[k].rects.clear();
+        this->batchesCount++;
+    }
+    this->batches[k].rects.insert(this->batches[k].rects.end(), rects, rects + count);
+}
+
+//copies the whole layer to layer->rect, or its source part (atlas cell) to destination
+inline void RenderTarget::drawLayer(RenderLayer* layer, const SDL_Rect* source, const SDL_Rect* destination) {
+    SDL_Rect rect = layer->rect;
+    if (destination != NULL) {
+        rect.x = destination->x;
+        rect.y = destination->y;
+    }
+    if (source != NULL) {
+        rect.w = source->w;
+        rect.h = source->h;
+    }
+
+    if (this->backend == surfaceBackend) {
+        //convert once, so every later copy is a plain blit
+        if (layer->surface->format->format != this->surface->format->format) {
+            SDL_Surface* converted = SDL_ConvertSurface(layer->surface, this->surface->format, 0);
+            if (converted != NULL) {
+                SDL_FreeSurface(layer->surface);
+                layer->surface = converted;
+            }
+        }
+        SDL_BlitSurface(layer->surface, source, this->surface, &rect);
+        return;
+    }
+
+    if (layer->texture == NULL || layer->textureRenderer != this->renderer) {
+        if (layer->texture != NULL)SDL_DestroyTexture(layer->texture);
+        layer->texture = SDL_CreateTextureFromSurface(this->renderer, layer->surface);
+        layer->textureRenderer = this->renderer;
+    }
+    //queued fills were issued before the layer, keep them under it
+    flush();
+    SDL_RenderCopy(this->renderer, layer->texture, source, &rect);
+}
+
+inline void RenderTarget::flush() {
+    if (this->backend == surfaceBackend)return;
+
+    for (int k = 0; k < this->batchesCount; k++) {
+        SDL_SetRenderDrawColor(this->renderer, (this->batches[k].color >> 16) & 0xFF, (this->batches[k].color >> 8) & 0xFF, this->batches[k].color & 0xFF, 255);
+        SDL_RenderFillRects(this->renderer, this->batches[k].rects.data(), (int)this->batches[k].rects.size());
+    }
+    this->batchesCount = 0;
+}
+
+inline void RenderTarget::present() {
+    if (this->backend == surfaceBackend) {
+        if (this->window != NULL)SDL_UpdateWindowSurface(this->window);
+        return;
+    }
+
+    flush();
+    SDL_SetRenderTarget(this->renderer, NULL);
+    SDL_RenderCopy(this->renderer, this->canvas, NULL, NULL);
+    SDL_RenderPresent(this->renderer);
+    SDL_SetRenderTarget(this->renderer, this->canvas);
+}
+
+inline bool RenderTarget::saveBMP(const char* path) {
+    if (this->backend == surfaceBackend)return(SDL_SaveBMP(this->surface, path) == 0);
+
+    int sizeX, sizeY;
+    flush();
+    SDL_QueryTexture(this->canvas, NULL, NULL, &sizeX, &sizeY);
+    SDL_Surface* frame = SDL_CreateRGBSurface(0, sizeX, sizeY, 32, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+    if (frame == NULL)return false;
+
+    bool success = SDL_RenderReadPixels(this->renderer, NULL, SDL_PIXELFORMAT_RGB888, frame->pixels, frame->pitch) == 0
+        && SDL_SaveBMP(frame, path) == 0;
+    SDL_FreeSurface(frame);
+    return success;
+}
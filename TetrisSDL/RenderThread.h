@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <atomic>
+#include <SDL.h>
+#include "RenderTarget.h"
+#include "Window.h"
+#include "Map.h"
+#include "Blocks.h"
+#include "Game.h"
+#include "FrameSnapshot.h"
+#include "FrameView.h"
+#include "TripleBuffer.h"
+
+//Draws the frames a Game publishes on its own thread, so presents never hold up gravity or input.
+//The view Map/Blocks/Game are set up like the simulated ones but are only ever drawn from snapshots;
+//the simulated ones stay without target.
+class RenderThread {
+    Map* viewMap;
+    Blocks* viewBlocks;
+    Game* view;
+    Window* window;
+    FrameView frameView;
+    TripleBuffer<FrameSnapshot> frames;
+    SDL_sem* framesReady = NULL;
+    SDL_sem* started = NULL;
+    SDL_Thread* thread = NULL;
+    std::atomic<bool> running{ false };
+    bool targetReady = false;
+
+    static int threadMain(void* data);
+public:
+    RenderThread(Game& view, Map& viewMap, Blocks& viewBlocks, Window& window) :
+        viewMap(&viewMap), viewBlocks(&viewBlocks), view(&view), window(&window), frameView(view, viewMap, viewBlocks) {}
+
+    bool start(Game& game);
+    void stop();
+
+    ~RenderThread() {
+        stop();
+    }
+};
+
+//creates the window target on the new thread and hooks game up to publish into it
+inline bool RenderThread::start(Game& game) {
+    if (!this->frameView.fits())return false;
+
+    this->framesReady = SDL_CreateSemaphore(0);
+    this->started = SDL_CreateSemaphore(0);
+    this->running = true;
+    this->thread = SDL_CreateThread(threadMain, "render", this);
+    if (this->thread == NULL) {
+        this->running = false;
+        return false;
+    }
+
+    SDL_SemWait(this->started);
+    if (!this->targetReady) {
+        stop();
+        return false;
+    }
+    game.frames = &this->frames;
+    game.framesReady = this->framesReady;
+    return true;
+}
+
+inline void RenderThread::stop() {
+    if (this->thread != NULL) {
+        this->running = false;
+        SDL_SemPost(this->framesReady);
+        SDL_WaitThread(this->thread, NULL);
+        this->thread = NULL;
+    }
+    if (this->framesReady != NULL)SDL_DestroySemaphore(this->framesReady);
+    if (this->started != NULL)SDL_DestroySemaphore(this->started);
+    this->framesReady = NULL;
+    this->started = NULL;
+}
+
+inline int RenderThread::threadMain(void* data) {
+    RenderThread* self = static_cast<RenderThread*>(data);
+
+    self->targetReady = self->window->createTarget();
+    SDL_SemPost(self->started);
+    if (!self->targetReady) {
+        self->window->freeTarget();
+        return 1;
+    }
+    self->viewMap->target = self->viewBlocks->target = self->view->target = &self->window->target;
+
+    while (self->running) {
+        //wakes on every published frame, and on its own while a line clear blinks
+        SDL_SemWaitTimeout(self->framesReady, self->frameView.isFlashing() ? 10 : 100);
+
+        if (self->frames.consume())self->frameView.drawFrame(self->frames.readSlot());
+        else self->frameView.tick();
+    }
+
+    self->viewMap->target = NULL;
+    self->viewBlocks->target = nullptr;
+    self->view->target = NULL;
+    self->window->freeTarget();
+    return 0;
+}
@@ -0,0 +1,167 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <SDL.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "GameState.h"
+#include "TripleBuffer.h"
+
+//Save file: SaveHeader followed by GameState. It is written to path + ".tmp", flushed to disk
+//and renamed over the old save, so a crash mid-write leaves the previous save intact.
+struct SaveHeader {
+    Uint32 magic;
+    Uint32 version;//bumped on every GameState layout change
+    Uint32 stateSize;
+    Uint32 checksum;//FNV-1a of the state bytes
+};
+
+struct SaveData {
+    SaveHeader header;
+    GameState state;
+};
+
+const Uint32 saveMagic = 0x56415354;//"TSAV"
+const Uint32 saveVersion = 3;
+
+inline Uint32 saveChecksum(const GameState& state) {
+    const Uint8* bytes = reinterpret_cast<const Uint8*>(&state);
+    Uint32 hash = 2166136261u;
+    for (size_t k = 0; k < sizeof(GameState); k++)hash = (hash ^ bytes[k]) * 16777619u;
+    return hash;
+}
+
+//save.dat in the user's pref directory, empty when SDL can't provide one
+inline std::string savePath() {
+    char* directory = SDL_GetPrefPath("pcRipper", "Tetris");
+    if (directory == NULL)return std::string();
+    std::string path = std::string(directory) + "save.dat";
+    SDL_free(directory);
+    return path;
+}
+
+inline bool writeSave(const std::string& path, const GameState& state) {
+    std::string temporary = path + ".tmp";
+    SaveData data{ { saveMagic, saveVersion, sizeof(GameState), saveChecksum(state) }, state };
+#ifdef _WIN32
+    HANDLE file = CreateFileA(temporary.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)return false;
+    DWORD written = 0;
+    bool success = WriteFile(file, &data, sizeof(data), &written, NULL) && written == sizeof(data) && FlushFileBuffers(file);
+    success = CloseHandle(file) && success;
+    if (success)success = MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    int file = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)return false;
+    bool success = write(file, &data, sizeof(data)) == (ssize_t)sizeof(data) && fsync(file) == 0;
+    success = (close(file) == 0) && success;
+    if (success)success = rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+    if (!success)remove(temporary.c_str());
+    return success;
+}
+
+//false for a missing, foreign, outdated or damaged save
+inline bool readSave(const std::string& path, GameState& state) {
+    SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+    if (file == NULL)return false;
+
+    SaveData data;
+    bool success = SDL_RWread(file, &data, sizeof(data), 1) == 1 && data.header.magic == saveMagic
+        && data.header.version == saveVersion && data.header.stateSize == sizeof(GameState)
+        && data.header.checksum == saveChecksum(data.state);
+    SDL_RWclose(file);
+    if (success)state = data.state;
+    return success;
+}
+
+struct SaveRequest {
+    bool isDiscard;//the game ended, the save goes away
+    GameState state;
+};
+
+//Writes saves on its own thread. post() only publishes the state slot, so the game loop
+//never waits for the disk; states posted faster than they are written are dropped except the newest.
+class SaveWriter {
+    std::string path;
+    TripleBuffer<SaveRequest> requests;
+    SDL_sem* requestReady = NULL;
+    SDL_Thread* thread = NULL;
+    std::atomic<bool> running{ false };
+
+    static int threadMain(void* data);
+public:
+    bool start(const std::string& path);
+    GameState& stateSlot() { return requests.writeSlot().state; }
+    void post();
+    void discard();
+    void stop();
+
+    ~SaveWriter() {
+        stop();
+    }
+};
+
+inline bool SaveWriter::start(const std::string& path) {
+    this->path = path;
+    this->requestReady = SDL_CreateSemaphore(0);
+    this->running = true;
+    this->thread = SDL_CreateThread(threadMain, "save", this);
+    if (this->thread == NULL) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+//writes what was filled into stateSlot()
+inline void SaveWriter::post() {
+    this->requests.writeSlot().isDiscard = false;
+    this->requests.publish();
+    SDL_SemPost(this->requestReady);
+}
+
+inline void SaveWriter::discard() {
+    this->requests.writeSlot().isDiscard = true;
+    this->requests.publish();
+    SDL_SemPost(this->requestReady);
+}
+
+//the last posted request is still carried out
+inline void SaveWriter::stop() {
+    if (this->thread != NULL) {
+        this->running = false;
+        SDL_SemPost(this->requestReady);
+        SDL_WaitThread(this->thread, NULL);
+        this->thread = NULL;
+    }
+    if (this->requestReady != NULL)SDL_DestroySemaphore(this->requestReady);
+    this->requestReady = NULL;
+    this->running = false;
+}
+
+inline int SaveWriter::threadMain(void* data) {
+    SaveWriter* self = static_cast<SaveWriter*>(data);
+
+    for (bool isLast = false; !isLast;) {
+        SDL_SemWait(self->requestReady);
+        isLast = !self->running;
+        if (!self->requests.consume())continue;
+
+        const SaveRequest& request = self->requests.readSlot();
+        if (request.isDiscard)remove(self->path.c_str());
+        else if (!writeSave(self->path, request.state))SDL_Log("save failed: %s", self->path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+﻿#pragma once
+#include <cstring>
+#include <SDL.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET SocketHandle;
+const SocketHandle invalidSocket = INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+const SocketHandle invalidSocket = -1;
+#endif
+
+//Platform part of the sockets: Winsock or BSD sockets behind the same few calls.
+//Every startSockets needs its stopSockets (Winsock counts them), both do nothing elsewhere.
+
+inline bool startSockets() {
+#ifdef _WIN32
+    WSADATA data;
+    return(WSAStartup(MAKEWORD(2, 2), &data) == 0);
+#else
+    return true;
+#endif
+}
+
+inline void stopSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+inline void closeSocket(SocketHandle handle) {
+    if (handle == invalidSocket)return;
+#ifdef _WIN32
+    closesocket(handle);
+#else
+    close(handle);
+#endif
+}
+
+inline bool setNonBlocking(SocketHandle handle) {
+#ifdef _WIN32
+    u_long isNonBlocking = 1;
+    return(ioctlsocket(handle, FIONBIO, &isNonBlocking) == 0);
+#else
+    return(fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) == 0);
+#endif
+}
+
+//the last call failed only because the socket would have blocked
+inline bool isWouldBlock() {
+#ifdef _WIN32
+    return(WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+    return(errno == EAGAIN || errno == EWOULDBLOCK);
+#endif
+}
+
+//small messages go out at once instead of waiting for more data
+inline void setNoDelay(SocketHandle handle) {
+    int isNoDelay = 1;
+    setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&isNoDelay, sizeof(isNoDelay));
+#ifdef SO_NOSIGPIPE
+    setsockopt(handle, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&isNoDelay, sizeof(isNoDelay));
+#endif
+}
+
+//non-blocking TCP socket listening on `port` of every interface
+inline SocketHandle listenTcp(Uint16 port, int backlog = SOMAXCONN) {
+    SocketHandle handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (handle == invalidSocket)return invalidSocket;
+
+    int isReused = 1;
+    setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&isReused, sizeof(isReused));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (!setNonBlocking(handle) || bind(handle, (sockaddr*)&address, sizeof(address)) != 0 || listen(handle, backlog) != 0) {
+        closeSocket(handle);
+        return invalidSocket;
+    }
+    return handle;
+}
+
+//next waiting connection as a non-blocking socket, invalidSocket when there is none
+inline SocketHandle acceptTcp(SocketHandle listener) {
+    SocketHandle handle = accept(listener, NULL, NULL);
+    if (handle == invalidSocket)return invalidSocket;
+    if (!setNonBlocking(handle)) {
+        closeSocket(handle);
+        return invalidSocket;
+    }
+    setNoDelay(handle);
+    return handle;
+}
+
+//waits for the connection, the socket is non-blocking afterwards
+inline SocketHandle connectTcp(const char* host, Uint16 port) {
+    addrinfo hints, *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL)return invalidSocket;
+
+    sockaddr_in address;
+    memcpy(&address, result->ai_addr, sizeof(address));
+    address.sin_port = htons(port);
+    freeaddrinfo(result);
+
+    SocketHandle handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (handle == invalidSocket)return invalidSocket;
+    if (connect(handle, (sockaddr*)&address, sizeof(address)) != 0 || !setNonBlocking(handle)) {
+        closeSocket(handle);
+        return invalidSocket;
+    }
+    setNoDelay(handle);
+    return handle;
+}
+
+//bytes sent, 0 when the socket buffer is full, -1 when the connection is gone
+inline int sendSome(SocketHandle handle, const void* data, int size) {
+#ifdef MSG_NOSIGNAL
+    int sent = (int)send(handle, (const char*)data, size, MSG_NOSIGNAL);
+#else
+    int sent = (int)send(handle, (const char*)data, size, 0);
+#endif
+    if (sent >= 0)return sent;
+    return isWouldBlock() ? 0 : -1;
+}
+
+//bytes received, 0 when nothing is waiting, -1 when the connection is closed or broken
+inline int receiveSome(SocketHandle handle, void* data, int size) {
+    int received = (int)recv(handle, (char*)data, size, 0);
+    if (received > 0)return received;
+    return(received < 0 && isWouldBlock()) ? 0 : -1;
+}
@@ -0,0 +1,493 @@
+﻿#pragma once
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include <SDL.h>
+#include "Arena.h"
+#include "GameState.h"
+#include "TripleBuffer.h"
+#include "Sockets.h"
+#include "Poller.h"
+
+//Spectator stream: one game watched by many viewers over TCP. Every frame is
+//Uint16 payload size (little-endian) + payload:
+//  Uint8 SpectatorSections, then the sections it names in this order
+//  keyframe  Uint8 sizeY, sizeX; the other sections are all there, every row included
+//  rows      varint mask of the changed rows, bit 0 - bottom row; each row as GameState::cells
+//            nibbles, (sizeX + 1) / 2 bytes, bottom row first
+//  piece     Uint8 (block + 1) | (form + 1) << 4, Uint8 posY, posX
+//  score     zigzag varint of the change
+//  pool      Uint8 size, then size bytes of block + 1
+//  status    Uint8 highestPoint, currentLevel, SpectatorStatus
+//Deltas only make sense to a viewer that saw the keyframe before them.
+enum SpectatorSections {
+    sectionKeyframe = 1,
+    sectionRows = 2,
+    sectionPiece = 4,
+    sectionScore = 8,
+    sectionPool = 16,
+    sectionStatus = 32
+};
+
+enum SpectatorStatus {
+    statusPaused = 1,
+    statusGameOver = 2,
+    statusSeted = 4
+};
+
+//GameState rows are packed two cells per byte over the whole field, so with an odd sizeX
+//a row starts in the middle of a byte; even rows are whole bytes and are copied as such
+inline int spectatorRowBytes(int sizeX) { return (sizeX + 1) / 2; }
+
+inline bool spectatorRowDiffers(const GameState& a, const GameState& b, int y) {
+    int sizeX = a.sizeX;
+    if (sizeX % 2 == 0)return memcmp(a.cells + y * sizeX / 2, b.cells + y * sizeX / 2, sizeX / 2) != 0;
+    for (int x = 0, k = y * sizeX; x < sizeX; x++, k++) {
+        if (((a.cells[k / 2] ^ b.cells[k / 2]) >> (k % 2 * 4)) & 0xF)return true;
+    }
+    return false;
+}
+
+inline Uint8* spectatorWriteRow(const GameState& state, int y, Uint8* out) {
+    int sizeX = state.sizeX;
+    if (sizeX % 2 == 0) {
+        memcpy(out, state.cells + y * sizeX / 2, sizeX / 2);
+        return out + sizeX / 2;
+    }
+    memset(out, 0, spectatorRowBytes(sizeX));
+    for (int x = 0, k = y * sizeX; x < sizeX; x++, k++)out[x / 2] |= ((state.cells[k / 2] >> (k % 2 * 4)) & 0xF) << (x % 2 * 4);
+    return out + spectatorRowBytes(sizeX);
+}
+
+inline const Uint8* spectatorReadRow(GameState& state, int y, const Uint8* in) {
+    int sizeX = state.sizeX;
+    if (sizeX % 2 == 0) {
+        memcpy(state.cells + y * sizeX / 2, in, sizeX / 2);
+        return in + sizeX / 2;
+    }
+    for (int x = 0, k = y * sizeX; x < sizeX; x++, k++) {
+        state.cells[k / 2] = (Uint8)((state.cells[k / 2] & ~(0xF << (k % 2 * 4))) | (((in[x / 2] >> (x % 2 * 4)) & 0xF) << (k % 2 * 4)));
+    }
+    return in + spectatorRowBytes(sizeX);
+}
+
+inline Uint8* writeVarint(Uint32 value, Uint8* out) {
+    for (; value >= 0x80; value >>= 7)*out++ = (Uint8)(value | 0x80);
+    *out++ = (Uint8)value;
+    return out;
+}
+
+//nullptr when the value runs past end
+inline const Uint8* readVarint(const Uint8* in, const Uint8* end, Uint32& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 35; shift += 7) {
+        Uint8 byte = *in++;
+        value |= (Uint32)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))return in;
+    }
+    return nullptr;
+}
+
+//Turns GameState snapshots into stream frames. Only the board, the falling block, the score,
+//the pool and the status are sent: timers, repeats and the random state stay with the player.
+class SpectatorEncoder {
+    GameState prev;//last state sent, what the viewers have
+    bool hasPrev = false;
+    int sinceKeyframe = 0;
+public:
+    //size prefix + sections + keyframe with every row of the largest GameState
+    static const int maxFrameSize = 2 + 1 + 2 + 5 + GameState::maxRows * GameState::maxColumns / 2 + 3 + 5 + 1 + GameState::maxPool + 3;
+    int keyframeInterval = 300;//frames, so a viewer that lost frames is back within a few seconds
+
+    int encode(const GameState& state, Uint8* out, bool isKeyframe = false);
+    //keyframe of the last state, for viewers that just came; 0 before the first state
+    int encodeKeyframe(Uint8* out) { return this->hasPrev ? encode(this->prev, out, true) : 0; }
+    void reset() { this->hasPrev = false; }
+};
+
+//`out` takes maxFrameSize bytes. Returns the frame size, 0 when nothing a viewer sees changed.
+inline int SpectatorEncoder::encode(const GameState& state, Uint8* out, bool isKeyframe) {
+    if (state.sizeY > GameState::maxRows || state.sizeX > GameState::maxColumns || state.poolSize > GameState::maxPool)return 0;
+    if (!this->hasPrev || state.sizeY != this->prev.sizeY || state.sizeX != this->prev.sizeX
+        || ++this->sinceKeyframe >= this->keyframeInterval)isKeyframe = true;
+
+    Uint32 rows = 0;
+    int sections = 0;
+    if (isKeyframe) {
+        sections = sectionKeyframe | sectionRows | sectionPiece | sectionScore | sectionPool | sectionStatus;
+        rows = (state.sizeY >= 32) ? 0xFFFFFFFFu : (1u << state.sizeY) - 1;
+    }
+    else {
+        for (int y = 0; y < state.sizeY; y++) {
+            if (spectatorRowDiffers(state, this->prev, y))rows |= 1u << (state.sizeY - 1 - y);
+        }
+        if (rows != 0)sections |= sectionRows;
+        if (state.fallingBlock != this->prev.fallingBlock || state.fallingForm != this->prev.fallingForm
+            || state.fallingPosY != this->prev.fallingPosY || state.fallingPosX != this->prev.fallingPosX)sections |= sectionPiece;
+        if (state.score != this->prev.score)sections |= sectionScore;
+        if (state.poolSize != this->prev.poolSize || memcmp(state.pool, this->prev.pool, state.poolSize) != 0)sections |= sectionPool;
+        if (state.highestPoint != this->prev.highestPoint || state.currentLevel != this->prev.currentLevel || state.isPaused != this->prev.isPaused
+            || state.isGameOver != this->prev.isGameOver || state.isSeted != this->prev.isSeted)sections |= sectionStatus;
+        if (sections == 0)return 0;
+    }
+
+    Uint8* p = out + 2;
+    *p++ = (Uint8)sections;
+    if (sections & sectionKeyframe) {
+        *p++ = state.sizeY;
+        *p++ = state.sizeX;
+    }
+    if (sections & sectionRows) {
+        p = writeVarint(rows, p);
+        for (int y = state.sizeY - 1; y >= 0; y--) {
+            if (rows & (1u << (state.sizeY - 1 - y)))p = spectatorWriteRow(state, y, p);
+        }
+    }
+    if (sections & sectionPiece) {
+        *p++ = (Uint8)((state.fallingBlock + 1) | (state.fallingForm + 1) << 4);
+        *p++ = state.fallingPosY;
+        *p++ = state.fallingPosX;
+    }
+    if (sections & sectionScore) {
+        //keyframes count from 0, the difference is taken in Uint32 so it wraps instead of overflowing
+        Uint32 change = (Uint32)state.score - ((sections & sectionKeyframe) ? 0 : (Uint32)this->prev.score);
+        p = writeVarint((change << 1) ^ (Uint32)((Sint32)change >> 31), p);
+    }
+    if (sections & sectionPool) {
+        *p++ = state.poolSize;
+        for (int k = 0; k < state.poolSize; k++)*p++ = (Uint8)(state.pool[k] + 1);
+    }
+    if (sections & sectionStatus) {
+        *p++ = state.highestPoint;
+        *p++ = state.currentLevel;
+        *p++ = (Uint8)((state.isPaused ? statusPaused : 0) | (state.isGameOver ? statusGameOver : 0) | (state.isSeted ? statusSeted : 0));
+    }
+
+    int size = (int)(p - out);
+    out[0] = (Uint8)((size - 2) & 0xFF);
+    out[1] = (Uint8)((size - 2) >> 8);
+    if (isKeyframe)this->sinceKeyframe = 0;
+    if (&state != &this->prev)this->prev = state;
+    this->hasPrev = true;
+    return size;
+}
+
+//Rebuilds the state from frame payloads (without the size prefix). The fields the stream doesn't carry
+//are left as a restorable idle game: nothing held, no timers running.
+class SpectatorDecoder {
+    bool hasKeyframe = false;
+public:
+    GameState state;
+
+    SpectatorDecoder() {
+        memset(&this->state, 0, sizeof(GameState));
+        this->state.randomState = 1;
+    }
+    //false for a damaged frame, or a delta before the first keyframe (it is skipped, the next keyframe syncs)
+    bool decode(const Uint8* payload, int size);
+    bool isSynced() { return hasKeyframe; }
+};
+
+inline bool SpectatorDecoder::decode(const Uint8* payload, int size) {
+    const Uint8* p = payload, *end = payload + size;
+    if (p >= end)return false;
+    int sections = *p++;
+    if (!(sections & sectionKeyframe) && !this->hasKeyframe)return false;
+
+    //decoded into a copy, a damaged frame leaves the state as it was
+    GameState next = this->state;
+    if (sections & sectionKeyframe) {
+        if (end - p < 2)return false;
+        next.sizeY = *p++;
+        next.sizeX = *p++;
+        if (next.sizeY == 0 || next.sizeY > GameState::maxRows || next.sizeX == 0 || next.sizeX > GameState::maxColumns)return false;
+        memset(next.cells, 0, sizeof(next.cells));
+    }
+    if (sections & sectionRows) {
+        Uint32 rows;
+        if ((p = readVarint(p, end, rows)) == nullptr)return false;
+        for (int y = next.sizeY - 1; y >= 0; y--) {
+            if (!(rows & (1u << (next.sizeY - 1 - y))))continue;
+            if (end - p < spectatorRowBytes(next.sizeX))return false;
+            p = spectatorReadRow(next, y, p);
+        }
+    }
+    if (sections & sectionPiece) {
+        if (end - p < 3)return false;
+        next.fallingBlock = (Sint8)((*p & 0xF) - 1);
+        next.fallingForm = (Sint8)((*p++ >> 4) - 1);
+        next.fallingPosY = *p++;
+        next.fallingPosX = *p++;
+    }
+    if (sections & sectionScore) {
+        Uint32 zigzag;
+        if ((p = readVarint(p, end, zigzag)) == nullptr)return false;
+        Uint32 change = (zigzag >> 1) ^ (0u - (zigzag & 1));
+        next.score = (Sint32)(((sections & sectionKeyframe) ? 0 : (Uint32)next.score) + change);
+    }
+    if (sections & sectionPool) {
+        if (p >= end || *p > GameState::maxPool || end - p < 1 + *p)return false;
+        next.poolSize = *p++;
+        for (int k = 0; k < GameState::maxPool; k++)next.pool[k] = (k < next.poolSize) ? (Sint8)(*p++ - 1) : -1;
+    }
+    if (sections & sectionStatus) {
+        if (end - p < 3)return false;
+        next.highestPoint = *p++;
+        next.currentLevel = *p++;
+        next.isPaused = (*p & statusPaused) != 0;
+        next.isGameOver = (*p & statusGameOver) != 0;
+        next.isSeted = (*p++ & statusSeted) != 0;
+    }
+    if (p != end)return false;
+
+    this->state = next;
+    this->hasKeyframe = true;
+    return true;
+}
+
+//one encoded frame, shared by every viewer it is queued for and sent straight from here
+struct SpectatorChunk {
+    int refs = 0;
+    int size = 0;
+    bool isKeyframe = false;
+    Uint8 data[SpectatorEncoder::maxFrameSize];
+};
+
+struct SpectatorViewer {
+    static const int queueSize = 64;//frames a viewer may lag behind before it is resynced with a keyframe
+
+    SocketHandle socket = invalidSocket;
+    int index = 0;//position in SpectatorStream::viewers
+    SpectatorChunk* queue[queueSize];
+    int head = 0, count = 0;
+    int offset = 0;//bytes of queue[head] already sent
+    bool isSynced = false;//got a keyframe, deltas make sense to it
+    bool isWriting = false;//waits for the socket to take more
+};
+
+//Serves the stream of one game to local TCP viewers from its own thread. The game posts
+//snapshots like to SaveWriter; the thread encodes the newest one once and queues that one buffer
+//to every viewer, so a frame costs one encode and no copies however many viewers there are.
+//Viewers that fall behind lose their queue and wait for the next keyframe.
+class SpectatorStream {
+    TripleBuffer<GameState> states;
+    SDL_Thread* thread = NULL;
+    std::atomic<bool> running{ false };
+    SocketHandle listener = invalidSocket;
+    Poller poller;
+    SpectatorEncoder encoder;
+    Arena arena{ 1 << 16 };//chunks and viewers, recycled and freed with the stream
+    std::vector<SpectatorChunk*> freeChunks;
+    std::vector<SpectatorViewer*> viewers, freeViewers;
+    bool isKeyframeWanted = false;
+    bool hasSockets = false;
+
+    static int threadMain(void* data);
+    void acceptViewers();
+    void endViewer(SpectatorViewer* viewer);
+    bool flush(SpectatorViewer* viewer);
+    void broadcast(SpectatorChunk* chunk);
+    void release(SpectatorChunk* chunk);
+    SpectatorChunk* newChunk();
+public:
+    static const int waitMS = 4;//newest snapshot is picked up at least this often
+    //statistics, read after stop
+    int framesSent = 0, keyframesSent = 0, resyncs = 0, viewersServed = 0;
+    Uint64 bytesEncoded = 0;
+
+    bool start(Uint16 port);
+    GameState& stateSlot() { return states.writeSlot(); }
+    void post() { states.publish(); }
+    void stop();
+
+    ~SpectatorStream() {
+        stop();
+    }
+};
+
+inline bool SpectatorStream::start(Uint16 port) {
+    this->hasSockets = startSockets();
+    if (!this->hasSockets)return false;
+    this->listener = listenTcp(port);
+    if (this->listener == invalidSocket || !this->poller.open() || !this->poller.add(this->listener, nullptr)) {
+        stop();
+        return false;
+    }
+    this->running = true;
+    this->thread = SDL_CreateThread(threadMain, "spectators", this);
+    if (this->thread == NULL) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+inline void SpectatorStream::stop() {
+    if (this->thread != NULL) {
+        this->running = false;
+        SDL_WaitThread(this->thread, NULL);
+        this->thread = NULL;
+    }
+    this->running = false;
+    while (!this->viewers.empty())endViewer(this->viewers.back());
+    if (this->listener != invalidSocket)closeSocket(this->listener);
+    this->listener = invalidSocket;
+    this->poller.close();
+    if (this->hasSockets)stopSockets();
+    this->hasSockets = false;
+}
+
+inline SpectatorChunk* SpectatorStream::newChunk() {
+    if (this->freeChunks.empty())return arenaNew<SpectatorChunk>();
+    SpectatorChunk* chunk = this->freeChunks.back();
+    this->freeChunks.pop_back();
+    return chunk;
+}
+
+inline void SpectatorStream::release(SpectatorChunk* chunk) {
+    if (--chunk->refs == 0)this->freeChunks.push_back(chunk);
+}
+
+inline int SpectatorStream::threadMain(void* data) {
+    SpectatorStream* self = static_cast<SpectatorStream*>(data);
+    sessionArena() = &self->arena;
+
+    PollEvent events[64];
+    while (self->running) {
+        int count = self->poller.wait(events, 64, waitMS);
+        //new viewers after the batch: one may reuse a viewer that ended in it
+        bool isAccepting = false;
+        for (int k = 0; k < count; k++) {
+            SpectatorViewer* viewer = static_cast<SpectatorViewer*>(events[k].data);
+            if (viewer == nullptr) {
+                isAccepting = true;
+                continue;
+            }
+            if (viewer->socket == invalidSocket)continue;
+            //viewers send nothing, reads only notice them leaving
+            bool isOpen = !(events[k].flags & pollClosed);
+            if (isOpen && (events[k].flags & pollRead)) {
+                Uint8 scratch[256];
+                int received;
+                while ((received = receiveSome(viewer->socket, scratch, sizeof(scratch))) > 0);
+                isOpen = received == 0;
+            }
+            if (isOpen && (events[k].flags & pollWrite))isOpen = self->flush(viewer);
+            if (!isOpen)self->endViewer(viewer);
+        }
+        if (isAccepting)self->acceptViewers();
+
+        SpectatorChunk* chunk = nullptr;
+        if (self->states.consume()) {
+            chunk = self->newChunk();
+            chunk->size = self->encoder.encode(self->states.readSlot(), chunk->data, self->isKeyframeWanted);
+        }
+        else if (self->isKeyframeWanted) {
+            chunk = self->newChunk();
+            chunk->size = self->encoder.encodeKeyframe(chunk->data);
+        }
+        if (chunk == nullptr)continue;
+        chunk->isKeyframe = chunk->size > 2 && (chunk->data[2] & sectionKeyframe);
+        if (chunk->isKeyframe)self->isKeyframeWanted = false;
+        if (chunk->size > 0)self->broadcast(chunk);
+        else self->freeChunks.push_back(chunk);
+    }
+
+    sessionArena() = nullptr;
+    return 0;
+}
+
+inline void SpectatorStream::acceptViewers() {
+    SocketHandle socket;
+    while ((socket = acceptTcp(this->listener)) != invalidSocket) {
+        SpectatorViewer* viewer;
+        if (this->freeViewers.empty())viewer = arenaNew<SpectatorViewer>();
+        else {
+            viewer = this->freeViewers.back();
+            this->freeViewers.pop_back();
+        }
+        viewer->socket = socket;
+        viewer->head = viewer->count = viewer->offset = 0;
+        viewer->isSynced = viewer->isWriting = false;
+        if (!this->poller.add(socket, viewer)) {
+            closeSocket(socket);
+            viewer->socket = invalidSocket;
+            this->freeViewers.push_back(viewer);
+            continue;
+        }
+        viewer->index = (int)this->viewers.size();
+        this->viewers.push_back(viewer);
+        this->viewersServed++;
+        this->isKeyframeWanted = true;
+    }
+}
+
+//the last viewer takes the freed place
+inline void SpectatorStream::endViewer(SpectatorViewer* viewer) {
+    for (; viewer->count > 0; viewer->count--, viewer->head = (viewer->head + 1) % SpectatorViewer::queueSize)release(viewer->queue[viewer->head]);
+    this->poller.remove(viewer->socket);
+    closeSocket(viewer->socket);
+    viewer->socket = invalidSocket;
+
+    SpectatorViewer* last = this->viewers.back();
+    this->viewers[viewer->index] = last;
+    last->index = viewer->index;
+    this->viewers.pop_back();
+    this->freeViewers.push_back(viewer);
+}
+
+//sends what the socket takes; false when the viewer is gone
+inline bool SpectatorStream::flush(SpectatorViewer* viewer) {
+    while (viewer->count > 0) {
+        SpectatorChunk* chunk = viewer->queue[viewer->head];
+        int sent = sendSome(viewer->socket, chunk->data + viewer->offset, chunk->size - viewer->offset);
+        if (sent < 0)return false;
+        if (sent == 0)break;
+        viewer->offset += sent;
+        if (viewer->offset < chunk->size)break;
+        viewer->offset = 0;
+        viewer->head = (viewer->head + 1) % SpectatorViewer::queueSize;
+        viewer->count--;
+        release(chunk);
+    }
+    //writable events only while something waits, level-triggered ones would fire all the time
+    bool isWriting = viewer->count > 0;
+    if (isWriting != viewer->isWriting) {
+        viewer->isWriting = isWriting;
+        if (!this->poller.modify(viewer->socket, viewer, isWriting ? (pollRead | pollWrite) : pollRead))return false;
+    }
+    return true;
+}
+
+inline void SpectatorStream::broadcast(SpectatorChunk* chunk) {
+    chunk->refs = 1;//held here until every viewer has it queued
+    this->framesSent++;
+    if (chunk->isKeyframe)this->keyframesSent++;
+    this->bytesEncoded += chunk->size;
+
+    for (size_t k = 0; k < this->viewers.size();) {
+        SpectatorViewer* viewer = this->viewers[k];
+        //a full queue is dropped but for the frame half on the wire, the rest of the stream must stay whole
+        if (viewer->count == SpectatorViewer::queueSize) {
+            int kept = (viewer->offset > 0) ? 1 : 0;
+            for (int n = kept; n < viewer->count; n++)release(viewer->queue[(viewer->head + n) % SpectatorViewer::queueSize]);
+            viewer->count = kept;
+            viewer->isSynced = false;
+            this->isKeyframeWanted = true;
+            this->resyncs++;
+        }
+        if (chunk->isKeyframe)viewer->isSynced = true;
+        if (viewer->isSynced) {
+            viewer->queue[(viewer->head + viewer->count) % SpectatorViewer::queueSize] = chunk;
+            viewer->count++;
+            chunk->refs++;
+        }
+        //only a write already waiting for the socket skips the attempt
+        if (!viewer->isWriting && !flush(viewer)) {
+            endViewer(viewer);
+            continue;
+        }
+        k++;
+    }
+    release(chunk);
+}
@@ -0,0 +1,111 @@
+﻿#pragma once
+#include <cstring>
+#include <SDL.h>
+#include "Game.h"
+#include "InputEvent.h"
+#include "Sockets.h"
+#include "SpectatorStream.h"
+
+//Watches a SpectatorStream: decoded states are restored into the local game and published or drawn,
+//the game itself never runs. Runs on the game thread like VersusSession.
+class SpectatorView {
+    Game* game;
+    SocketHandle socket = invalidSocket;
+    SpectatorDecoder decoder;
+    Uint8 buffer[4096];//received bytes not decoded yet, always less than a frame when receive returns
+    int used = 0;
+    bool hasSockets = false;
+public:
+    static const int pollMS = 4;//TCP data doesn't wake the game thread, so the socket is polled
+    //statistics
+    int framesShown = 0, framesSkipped = 0;
+    Uint64 bytesReceived = 0;
+
+    SpectatorView(Game& game) :game(&game) {}
+    bool connect(const char* host, Uint16 port);
+    int receive();
+    void show();
+    void run();
+    static void gameLoop(void* data);
+    void close();
+
+    ~SpectatorView() {
+        close();
+    }
+};
+
+inline bool SpectatorView::connect(const char* host, Uint16 port) {
+    close();
+    this->hasSockets = startSockets();
+    if (this->hasSockets)this->socket = connectTcp(host, port);
+    return this->socket != invalidSocket;
+}
+
+inline void SpectatorView::close() {
+    if (this->socket != invalidSocket)closeSocket(this->socket);
+    this->socket = invalidSocket;
+    if (this->hasSockets)stopSockets();
+    this->hasSockets = false;
+    this->used = 0;
+}
+
+//decodes every whole frame that arrived; frames decoded, -1 when the stream ended or is damaged
+inline int SpectatorView::receive() {
+    int decoded = 0, received;
+    do {
+        received = receiveSome(this->socket, this->buffer + this->used, (int)sizeof(this->buffer) - this->used);
+        if (received < 0)return -1;
+        this->used += received;
+        this->bytesReceived += received;
+
+        int start = 0, size;
+        while (this->used - start >= 2) {
+            size = this->buffer[start] | this->buffer[start + 1] << 8;
+            if (size + 2 > SpectatorEncoder::maxFrameSize)return -1;
+            if (this->used - start < size + 2)break;
+            //deltas before the first keyframe are expected after connecting
+            if (this->decoder.decode(this->buffer + start + 2, size))decoded++;
+            else if (this->decoder.isSynced())return -1;
+            else this->framesSkipped++;
+            start += size + 2;
+        }
+        memmove(this->buffer, this->buffer + start, this->used - start);
+        this->used -= start;
+    } while (received > 0);
+    return decoded;
+}
+
+//the newest decoded state goes on screen
+inline void SpectatorView::show() {
+    if (!this->game->restore(this->decoder.state))return;
+    this->framesShown++;
+    if (this->game->frames == nullptr)this->game->renderGame();
+    this->game->publishFrame();
+}
+
+//for InputThread::run, data is the view
+inline void SpectatorView::gameLoop(void* data) {
+    static_cast<SpectatorView*>(data)->run();
+}
+
+//until escape, quit or the end of the stream; only the last of the frames that came together is shown
+inline void SpectatorView::run() {
+    InputEvent event;
+    bool isRunning = true;
+    while (isRunning) {
+        double now = inputClockMS();
+        while (this->game->nextInput(event, now + 1)) {
+            if (event.type == inputQuit || (event.type == inputKeyDown && event.key == SDLK_ESCAPE))isRunning = false;
+        }
+
+        int decoded = receive();
+        if (decoded < 0) {
+            SDL_Log("spectator: stream ended after %d frames", this->framesShown);
+            break;
+        }
+        if (decoded > 0)show();
+
+        if (this->game->inputReady == NULL)SDL_Delay(pollMS);
+        else this->game->waitInput(now + pollMS);
+    }
+}
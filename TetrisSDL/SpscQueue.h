@@ -0,0 +1,43 @@
+﻿#pragma once
+#include <atomic>
+
+//Lock-free single producer / single consumer ring buffer, capacity must be a power of two.
+//push fails when the queue is full, the consumer sees items in push order.
+template<typename T, unsigned capacity>
+class SpscQueue {
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+    T items[capacity];
+    std::atomic<unsigned> head{ 0 };//next item to pop, written by the consumer
+    std::atomic<unsigned> tail{ 0 };//next free item, written by the producer
+public:
+    bool push(const T& item);
+    bool peek(T& item);
+    bool pop(T& item);
+};
+
+template<typename T, unsigned capacity>
+inline bool SpscQueue<T, capacity>::push(const T& item) {
+    unsigned position = this->tail.load(std::memory_order_relaxed);
+    if (position - this->head.load(std::memory_order_acquire) == capacity)return false;
+
+    this->items[position & (capacity - 1)] = item;
+    this->tail.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+//copies the oldest item without removing it
+template<typename T, unsigned capacity>
+inline bool SpscQueue<T, capacity>::peek(T& item) {
+    unsigned position = this->head.load(std::memory_order_relaxed);
+    if (position == this->tail.load(std::memory_order_acquire))return false;
+
+    item = this->items[position & (capacity - 1)];
+    return true;
+}
+
+template<typename T, unsigned capacity>
+inline bool SpscQueue<T, capacity>::pop(T& item) {
+    if (!peek(item))return false;
+    this->head.store(this->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return true;
+}
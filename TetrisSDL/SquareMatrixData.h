@@ -0,0 +1,91 @@
+﻿#pragma once
+#include <SDL.h>
+#include "Arena.h"
+
+struct SquareMatrixData {
+    uint16_t SizeY;
+    uint16_t SizeX;
+    SDL_Rect* rects;//one row-major block, row y starts at rects + y * stride
+    uint16_t stride;
+    SDL_Rect** matrix;//row pointers into rects
+    //
+    SDL_Rect* backgroundRect = NULL;
+    Arena* arena;//arena rects and matrix came from, nullptr when they are owned
+    uint16_t startY;
+    uint16_t startX;
+    uint16_t topOffset;
+    uint16_t leftOffset;
+    int backgroundColorRGB;
+    int squareColorRGB;
+    uint16_t squareSize;
+    uint16_t verticalPadding;
+    uint16_t horizontalPadding;
+    SquareMatrixData(
+        uint16_t SizeY, uint16_t SizeX,
+        uint16_t startY, uint16_t startX,
+        uint16_t topOffset, uint16_t leftOffset,
+        int backgroundColorRGB, int squareColorRGB,
+        uint16_t squareSize,
+        uint16_t verticalPadding, uint16_t horizontalPadding,
+        bool setMatrix = true
+    ) {
+        this->SizeY = SizeY;
+        this->SizeX = SizeX;
+        this->startY = startY;
+        this->startX = startX;
+        this->topOffset = topOffset;
+        this->leftOffset = leftOffset;
+        this->backgroundColorRGB = backgroundColorRGB;
+        this->squareColorRGB = squareColorRGB;
+        this->squareSize = squareSize;
+        this->verticalPadding = verticalPadding;
+        this->horizontalPadding = horizontalPadding;
+
+        this->arena = sessionArena();
+        this->backgroundRect = arenaNew<SDL_Rect>(SDL_Rect{ this->startX,this->startY,this->getMatrixFieldSizeX(),this->getMatrixFieldSizeY() });
+
+        this->stride = SizeX;
+        if (setMatrix) {
+            rects = arenaArray<SDL_Rect>(SizeY * stride);
+            matrix = arenaArray<SDL_Rect*>(SizeY);
+            for (int y = 0, sY = topOffset + startY, x, sX; y < SizeY; y++, sY += squareSize + verticalPadding) {
+                matrix[y] = rects + y * stride;
+                for (x = 0, sX = leftOffset + startX; x < SizeX; x++, sX += squareSize + horizontalPadding) {
+                    matrix[y][x] = SDL_Rect{ sX, sY,squareSize,squareSize };
+                }
+            }
+        }
+        else {
+            rects = nullptr;
+            matrix = nullptr;
+        }
+
+    }
+    int getMatrixFieldSizeY(bool withTopOffset = true) {
+        return(((withTopOffset) ? topOffset * 2 : 0) + squareSize * SizeY + (SizeY - 1) * verticalPadding);
+    }
+    int getMatrixFieldSizeX(bool withLeftOffset = true) {
+        return(((withLeftOffset) ? leftOffset * 2 : 0) + squareSize * SizeX + (SizeX - 1) * horizontalPadding);
+    }
+    ~SquareMatrixData() {
+        if (matrix != nullptr) {
+            arenaFree(rects, arena);
+            arenaFree(matrix, arena);
+        }
+        if (arena == nullptr)delete backgroundRect;
+    }
+};
+
+inline SDL_Rect getBorder(const SDL_Rect* block, int lB, int tB, int rB, int bB) {
+    return(SDL_Rect{ block->x - lB, block->y - tB, block->w + lB + rB, block->h + tB + bB });
+}
+
+inline SDL_Rect* renderBorder(SDL_Rect* block, int lB, int tB, int rB, int bB) {
+    SDL_Rect* rect = new SDL_Rect{
+        block->x - lB,
+        block->y - tB,
+        block->w + lB + rB,
+        block->h + tB + bB
+    };
+    return(rect);
+};
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include "Map.h"
+#include "Blocks.h"
+
+enum Colors {
+    iconGrey = 0x9E9E9E,
+    iconBlue = 0x3F51B5,
+    iconPurple = 0x9C27B0,
+    blockYellow = 0xF0F000,
+    blockCayan = 0x00F0F0,
+    blockRed = 0xF00000,
+    blockGreen = 0x00F000,
+    blockPurple= 0xA000F0,
+    blockBlue = 0x0000F0,
+    blockOrange = 0xF0A000,
+    blockWhite = 0xFFFFFF,
+    blockRed2 = 0xFF0000,
+    blockGhost = 0x3C3C3C
+};
+
+//symbols and colors of the standard blocks set
+inline void setupMapSymbols(Map& obj) {
+    obj.symbolsCount = 10;
+    const char symbols[10] = { '@','#','0','a','$','8','f','-','p','.' };
+    const int symbolsColors[10] = {
+        blockYellow,
+        blockCayan,
+        blockRed,
+        blockGreen,
+        blockPurple,
+        blockBlue,
+        blockOrange,
+        blockWhite,
+        blockRed2,
+        blockGhost
+    };
+    obj.symbols = arenaArray<char>(obj.symbolsCount);
+    obj.symbolsColors = arenaArray<int>(obj.symbolsCount);
+    std::copy(symbols, symbols + obj.symbolsCount, obj.symbols);
+    std::copy(symbolsColors, symbolsColors + obj.symbolsCount, obj.symbolsColors);
+    obj.ghostSymbol = '.';
+    obj.updateSymbols();
+}
+
+//standard tetrominoes with all of their forms
+inline void setupBlocks(Blocks& obj) {
+    obj.addBlock(2, 2, "@@n@@");
+
+    obj.addBlock(4, 1, "#n#n#n#");
+    obj[1]->addForm(1, 4, "####");
+
+    obj.addBlock(2, 3, "00 n 00");
+    obj[2]->addForm(3, 2, " 0n00n0 ");
+
+    obj.addBlock(2, 3, " aanaa ");
+    obj[3]->addForm(3, 2, "a naan a");
+
+    obj.addBlock(2, 3, " $ n$$$");
+    obj[4]->addForm(3, 2, "$ n$$n$ ");
+    obj[4]->addForm(2, 3, "$$$n $ ");
+    obj[4]->addForm(3, 2, " $n$$n $");
+
+    obj.addBlock(3, 2, " 8n 8n88");
+    obj[5]->addForm(2, 3, "8  n888");
+    obj[5]->addForm(3, 2, "88n8 n8 ");
+    obj[5]->addForm(2, 3, "888n  8");
+
+    obj.addBlock(3, 2, "f nf nff");
+    obj[6]->addForm(2, 3, "fffnf  ");
+    obj[6]->addForm(3, 2, "ffn fn f");
+    obj[6]->addForm(2, 3, "  fnfff");
+}
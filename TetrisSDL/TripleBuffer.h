@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <atomic>
+
+//Lock-free single producer / single consumer triple buffer.
+//Writer fills writeSlot() and publishes it, reader takes the newest published slot with consume().
+//Neither side ever waits; frames the reader didn't get to are dropped.
+template<typename T>
+class TripleBuffer {
+    static const int freshBit = 4;
+    T slots[3];
+    std::atomic<int> middle{ 1 };//slot in between, freshBit when it holds an unread frame
+    int back = 0;//writer's slot
+    int front = 2;//reader's slot
+public:
+    T& writeSlot() { return slots[back]; }
+    const T& readSlot() const { return slots[front]; }
+    void publish();
+    bool consume();
+};
+
+template<typename T>
+inline void TripleBuffer<T>::publish() {
+    this->back = this->middle.exchange(this->back | freshBit, std::memory_order_acq_rel) & ~freshBit;
+}
+
+//false when nothing new was published since the last consume
+template<typename T>
+inline bool TripleBuffer<T>::consume() {
+    if (!(this->middle.load(std::memory_order_relaxed) & freshBit))return false;
+    this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & ~freshBit;
+    return true;
+}
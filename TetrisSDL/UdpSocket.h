@@ -0,0 +1,92 @@
+﻿#pragma once
+#include <cstring>
+#include <SDL.h>
+#include "Sockets.h"
+
+//Non-blocking IPv4 UDP socket talking to one peer. The peer is set with setPeer, or taken
+//from the first datagram received when the socket was opened to listen.
+class UdpSocket {
+    SocketHandle handle = invalidSocket;
+    sockaddr_in peer;
+    bool hasPeer = false;
+    bool isStarted = false;//WSAStartup done
+public:
+    bool open(Uint16 port = 0);
+    bool setPeer(const char* host, Uint16 port);
+    bool isConnected() { return hasPeer; }
+    bool send(const void* data, int size);
+    int receive(void* data, int size);
+    void close();
+
+    ~UdpSocket() {
+        close();
+    }
+};
+
+//binds to `port` on every interface, 0 for any free port
+inline bool UdpSocket::open(Uint16 port) {
+    close();
+    if (!startSockets())return false;
+    this->isStarted = true;
+    this->handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (this->handle == invalidSocket) {
+        close();
+        return false;
+    }
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (!setNonBlocking(this->handle) || bind(this->handle, (sockaddr*)&address, sizeof(address)) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+inline bool UdpSocket::setPeer(const char* host, Uint16 port) {
+    addrinfo hints, *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL)return false;
+
+    memcpy(&this->peer, result->ai_addr, sizeof(this->peer));
+    this->peer.sin_port = htons(port);
+    freeaddrinfo(result);
+    this->hasPeer = true;
+    return true;
+}
+
+inline bool UdpSocket::send(const void* data, int size) {
+    if (this->handle == invalidSocket || !this->hasPeer)return false;
+    return sendto(this->handle, (const char*)data, size, 0, (const sockaddr*)&this->peer, sizeof(this->peer)) == size;
+}
+
+//size of the next datagram from the peer, 0 when there is none
+inline int UdpSocket::receive(void* data, int size) {
+    if (this->handle == invalidSocket)return 0;
+
+    for (;;) {
+        sockaddr_in from;
+        socklen_t fromSize = sizeof(from);
+        int received = (int)recvfrom(this->handle, (char*)data, size, 0, (sockaddr*)&from, &fromSize);
+        if (received <= 0)return 0;
+        if (!this->hasPeer) {
+            this->peer = from;
+            this->hasPeer = true;
+        }
+        //datagrams of anyone else are dropped
+        if (from.sin_addr.s_addr == this->peer.sin_addr.s_addr && from.sin_port == this->peer.sin_port)return received;
+    }
+}
+
+inline void UdpSocket::close() {
+    closeSocket(this->handle);
+    if (this->isStarted)stopSockets();
+    this->isStarted = false;
+    this->handle = invalidSocket;
+    this->hasPeer = false;
+}
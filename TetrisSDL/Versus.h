@@ -0,0 +1,353 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <SDL.h>
+#include "FrameSnapshot.h"
+#include "FrameView.h"
+#include "Game.h"
+#include "GameState.h"
+#include "InputEvent.h"
+#include "SaveFile.h"
+#include "TripleBuffer.h"
+#include "UdpSocket.h"
+
+enum VersusPacketType {
+    versusHello = 1,//joining side, until the first inputs come back
+    versusInputs = 2
+};
+
+enum VersusResult {
+    versusPlaying = 0,
+    versusWon = 1,
+    versusLost = 2,
+    versusDraw = 3,
+    versusDisconnected = 4
+};
+
+//Datagram both sides send every frame: the sender's inputs from firstFrame on. Every packet repeats
+//the inputs the receiver hasn't acknowledged, so lost datagrams are never resent on their own.
+//Fields are little endian on the wire.
+struct VersusPacket {
+    static const int maxInputs = 64;
+
+    Uint32 magic;
+    Uint8 type;
+    Uint8 count;//inputs in use
+    Uint16 reserved;
+    Uint32 seed;//blocks sequence of both games, chosen by the host
+    Sint32 firstFrame;
+    Sint32 ack;//last frame of the receiver's inputs the sender has
+    Sint32 syncFrame;//newest frame whose state doesn't depend on predictions any more, -1 for none
+    Uint32 syncHash;//hash of both games at syncFrame, see stateHash
+    Uint8 inputs[maxInputs];//Buttons of the sender's player
+};
+
+const Uint32 versusMagic = 0x53565354;//"TSVS"
+
+inline void swapPacket(VersusPacket& packet) {
+    packet.magic = SDL_SwapLE32(packet.magic);
+    packet.seed = SDL_SwapLE32(packet.seed);
+    packet.firstFrame = (Sint32)SDL_SwapLE32((Uint32)packet.firstFrame);
+    packet.ack = (Sint32)SDL_SwapLE32((Uint32)packet.ack);
+    packet.syncFrame = (Sint32)SDL_SwapLE32((Uint32)packet.syncFrame);
+    packet.syncHash = SDL_SwapLE32(packet.syncHash);
+}
+
+//Two-player versus with rollback: both sides simulate both games with Game::stepFrame and only
+//exchange inputs. The other player's missing inputs are predicted as the last known ones; when the
+//real ones differ, both games are restored from the snapshot of that frame and simulated again.
+//The local player's inputs are applied inputDelay frames late, which hides most of the latency.
+//Cleared lines push garbage rows under the other player's stack (see Game::lockBlock).
+//Player 0 is the host, player 1 the joining side. Both games stay headless (no target): a tick
+//that drew, blinked or presented would stretch rollbacks and the fixed clock.
+class VersusSession {
+public:
+    static const int frameMS = 16;//whole ms, so Game::snapshot/restore round trips exactly
+    static const int historySize = 64;//frames of inputs and snapshots kept, the deepest possible rollback
+    static const int maxPrediction = 12;//frames simulated ahead of the other player's inputs before waiting
+    static const int inputDelay = 2;
+    static const int disconnectMS = 5000;
+    static const int lingerMS = 1000;//inputs are still sent after the end, so the other side sees it too
+private:
+    Game* players[2];
+    int localPlayer = 0;
+    UdpSocket socket;
+    Uint32 seed = 0;
+    bool isStarted = false;
+    int frame = 0;//next frame to simulate
+    Uint8 inputs[2][historySize];//frame % historySize
+    int confirmed[2] = { -1, -1 };//last frame the input of each player is known for
+    Uint8 usedInputs[historySize];//remote inputs frames were simulated with
+    int rollbackFrame = -1;//earliest frame simulated with a wrong prediction, -1 for none
+    int peerAck = -1;
+    GameState states[historySize][2];//both games at the start of every frame
+    Uint32 hashes[historySize];
+    int peerSyncFrame = -1;
+    Uint32 peerSyncHash = 0;
+    int checkedFrame = -1;//final frames up to this one were checked for the end of the game
+    double lastReceived = 0;
+    int result = versusPlaying;
+    TripleBuffer<FrameSnapshot> displayFrames;//frames of the local game for display
+
+    void start(Uint32 seed, double now);
+    void simulate(int atFrame);
+    void rollback();
+    void receiveInputs(const VersusPacket& packet);
+    int finalFrame();
+    void checkFinal();
+    void show();
+public:
+    //statistics
+    int rollbacks = 0, resimulatedFrames = 0, stalls = 0, desyncs = 0;
+    Uint32 autoplaySeed = 0;//random buttons instead of the keyboard, for soak tests of two processes
+    FrameView* display = nullptr;//draws the local game's frames in place when no render thread takes them
+
+    VersusSession(Game& first, Game& second) {
+        players[0] = &first;
+        players[1] = &second;
+    }
+
+    bool host(Uint16 port, Uint32 seed);
+    bool join(const char* host, Uint16 port);
+    void poll(double now);
+    bool advance(Uint8 buttons);
+    void send();
+    int getFrame() { return frame; }
+    int getResult() { return result; }
+    void run();
+    static void gameLoop(void* data);
+};
+
+//waits for the joining side on `port`, player 0
+inline bool VersusSession::host(Uint16 port, Uint32 seed) {
+    this->localPlayer = 0;
+    this->seed = seed;
+    return this->socket.open(port);
+}
+
+//player 1, the game starts once the host answers
+inline bool VersusSession::join(const char* host, Uint16 port) {
+    this->localPlayer = 1;
+    return this->socket.open() && this->socket.setPeer(host, port);
+}
+
+inline void VersusSession::start(Uint32 seed, double now) {
+    this->seed = seed;
+    for (int p = 0; p < 2; p++) {
+        players[p]->resetGame();
+        players[p]->seedRandom(seed);
+        //frames before the delay have no inputs on either side
+        memset(inputs[p], 0, sizeof(inputs[p]));
+        confirmed[p] = inputDelay - 1;
+    }
+    this->isStarted = true;
+    this->lastReceived = now;
+}
+
+//both games at `atFrame` are snapshotted, then stepped with the inputs known or predicted for it
+inline void VersusSession::simulate(int atFrame) {
+    int slot = atFrame % historySize, remote = 1 - localPlayer;
+    for (int p = 0; p < 2; p++) {
+        memset(&states[slot][p], 0, sizeof(GameState));
+        players[p]->snapshot(states[slot][p], (double)atFrame * frameMS);
+    }
+    hashes[slot] = saveChecksum(states[slot][0]) * 31 + saveChecksum(states[slot][1]);
+
+    usedInputs[slot] = (atFrame <= confirmed[remote]) ? inputs[remote][slot] : inputs[remote][confirmed[remote] % historySize];
+    for (int p = 0; p < 2; p++)players[p]->stepFrame((p == localPlayer) ? inputs[p][slot] : usedInputs[slot], (double)atFrame * frameMS);
+
+    //garbage of this frame reaches the other board at the same frame on both sides
+    int sent[2]{ players[0]->takeGarbage(), players[1]->takeGarbage() };
+    for (int p = 0; p < 2; p++)players[p]->addGarbage(sent[1 - p]);
+}
+
+inline void VersusSession::rollback() {
+    int from = this->rollbackFrame;
+    this->rollbackFrame = -1;
+    for (int p = 0; p < 2; p++)players[p]->restore(states[from % historySize][p], (double)from * frameMS);
+    for (int k = from; k < this->frame; k++)simulate(k);
+    this->rollbacks++;
+    this->resimulatedFrames += this->frame - from;
+}
+
+inline void VersusSession::receiveInputs(const VersusPacket& packet) {
+    int remote = 1 - localPlayer;
+    for (int k = 0, atFrame; k < packet.count; k++) {
+        atFrame = packet.firstFrame + k;
+        if (atFrame != confirmed[remote] + 1)continue;
+
+        inputs[remote][atFrame % historySize] = packet.inputs[k];
+        confirmed[remote] = atFrame;
+        if (atFrame < this->frame && usedInputs[atFrame % historySize] != packet.inputs[k]
+            && (this->rollbackFrame < 0 || atFrame < this->rollbackFrame))this->rollbackFrame = atFrame;
+    }
+    this->peerAck = std::max(this->peerAck, (int)packet.ack);
+    if (packet.syncFrame > this->peerSyncFrame) {
+        this->peerSyncFrame = packet.syncFrame;
+        this->peerSyncHash = packet.syncHash;
+    }
+}
+
+//newest frame whose snapshot only depends on confirmed inputs, -1 before the first one
+inline int VersusSession::finalFrame() {
+    return std::min(this->frame - 1, std::min(confirmed[0], confirmed[1]) + 1);
+}
+
+//compares the other side's hash and looks for the end of the game in frames that became final
+inline void VersusSession::checkFinal() {
+    int last = finalFrame();
+    if (this->peerSyncFrame >= 0 && this->peerSyncFrame <= last && this->peerSyncFrame > this->frame - historySize
+        && hashes[this->peerSyncFrame % historySize] != this->peerSyncHash) {
+        if (this->desyncs++ == 0)SDL_Log("versus: desync at frame %d", this->peerSyncFrame);
+        this->peerSyncFrame = -1;
+    }
+
+    for (int atFrame = std::max(this->checkedFrame + 1, this->frame - historySize + 1); atFrame <= last && this->result == versusPlaying; atFrame++) {
+        bool isLocalOver = states[atFrame % historySize][localPlayer].isGameOver;
+        bool isRemoteOver = states[atFrame % historySize][1 - localPlayer].isGameOver;
+        if (isLocalOver || isRemoteOver)this->result = (isLocalOver && isRemoteOver) ? versusDraw : isLocalOver ? versusLost : versusWon;
+    }
+    this->checkedFrame = std::max(this->checkedFrame, last);
+}
+
+//takes in every datagram that arrived, corrects mispredictions at once
+inline void VersusSession::poll(double now) {
+    VersusPacket packet;
+    int size;
+    while ((size = this->socket.receive(&packet, sizeof(packet))) > 0) {
+        if (size < (int)offsetof(VersusPacket, inputs))continue;
+        swapPacket(packet);
+        if (packet.magic != versusMagic || packet.count > VersusPacket::maxInputs || size < (int)offsetof(VersusPacket, inputs) + packet.count)continue;
+
+        this->lastReceived = now;
+        if (!this->isStarted) {
+            if (localPlayer == 0 && packet.type == versusHello)start(this->seed, now);
+            else if (localPlayer == 1 && packet.type == versusInputs)start(packet.seed, now);
+        }
+        if (this->isStarted && packet.type == versusInputs)receiveInputs(packet);
+    }
+    if (!this->isStarted)return;
+
+    if (this->rollbackFrame >= 0)rollback();
+    checkFinal();
+    if (this->result == versusPlaying && now - this->lastReceived > disconnectMS)this->result = versusDisconnected;
+}
+
+//simulates the next frame with the local `buttons`, false while too far ahead of the other player
+inline bool VersusSession::advance(Uint8 buttons) {
+    if (!this->isStarted || this->result != versusPlaying)return false;
+    if (this->frame - confirmed[1 - localPlayer] > maxPrediction) {
+        this->stalls++;
+        return false;
+    }
+
+    int inputFrame = this->frame + inputDelay;
+    inputs[localPlayer][inputFrame % historySize] = buttons;
+    confirmed[localPlayer] = inputFrame;
+    simulate(this->frame);
+    this->frame++;
+    return true;
+}
+
+inline void VersusSession::send() {
+    VersusPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.magic = versusMagic;
+    packet.type = this->isStarted ? versusInputs : versusHello;
+    packet.seed = this->seed;
+    packet.ack = confirmed[1 - localPlayer];
+    packet.syncFrame = -1;
+    if (this->isStarted) {
+        int first = std::max(this->peerAck + 1, confirmed[localPlayer] - VersusPacket::maxInputs + 1);
+        packet.firstFrame = first;
+        packet.count = (Uint8)std::max(confirmed[localPlayer] - first + 1, 0);
+        for (int k = 0; k < packet.count; k++)packet.inputs[k] = inputs[localPlayer][(first + k) % historySize];
+        packet.syncFrame = finalFrame();
+        if (packet.syncFrame >= 0)packet.syncHash = hashes[packet.syncFrame % historySize];
+    }
+
+    int size = (int)offsetof(VersusPacket, inputs) + packet.count;
+    swapPacket(packet);
+    this->socket.send(&packet, size);
+}
+
+//the local game on screen once: published to the render thread, or drawn in place by display
+inline void VersusSession::show() {
+    players[localPlayer]->publishFrame();
+    if (this->display != nullptr && this->displayFrames.consume())this->display->drawFrame(this->displayFrames.readSlot());
+}
+
+//for InputThread::run, data is the session
+inline void VersusSession::gameLoop(void* data) {
+    static_cast<VersusSession*>(data)->run();
+}
+
+//the versus game loop, on the game thread like Game::startGame: frames are simulated on a fixed
+//clock, the local game is shown after every tick
+inline void VersusSession::run() {
+    Game* local = players[localPlayer];
+    InputEvent event;
+    Uint8 held = 0, tapped = 0, autoplayHeld = 0;
+    Uint32 autoplay = this->autoplaySeed;
+    double now, startTime = -1, endTime = -1;
+    bool isRunning = true, isStalled = false;
+    int rolledBack;
+    if (this->display != nullptr && local->frames == nullptr && this->display->fits())local->frames = &this->displayFrames;
+
+    while (isRunning) {
+        now = inputClockMS();
+        //presses shorter than a frame still reach it
+        while (local->nextInput(event, now + 1)) {
+            if (event.type == inputQuit || (event.type == inputKeyDown && event.key == SDLK_ESCAPE))isRunning = false;
+            else if (event.type == inputKeyDown && !event.isRepeat) {
+                held |= buttonOf(event.key);
+                tapped |= buttonOf(event.key);
+            }
+            else if (event.type == inputKeyUp)held &= ~buttonOf(event.key);
+        }
+
+        rolledBack = this->rollbacks;
+        poll(now);
+        isStalled = false;
+        if (this->isStarted && this->result == versusPlaying) {
+            if (startTime < 0) {
+                startTime = now;
+                show();
+            }
+            int due = (int)((now - startTime) / frameMS) + 1, simulated = this->frame;
+            while (this->frame < due) {
+                Uint8 buttons = held | tapped;
+                if (autoplay != 0) {
+                    autoplay ^= autoplay << 13;
+                    autoplay ^= autoplay >> 17;
+                    autoplay ^= autoplay << 5;
+                    if (this->frame % 8 == 0)autoplayHeld = autoplay & (buttonLeft | buttonRight | buttonDown | buttonRotate);
+                    buttons = autoplayHeld | ((autoplay % 40 == 0) ? buttonDrop : 0);
+                }
+                if (!advance(buttons)) {
+                    isStalled = true;
+                    break;
+                }
+                tapped = 0;
+            }
+            if (this->frame != simulated || this->rollbacks != rolledBack)show();
+        }
+        send();
+
+        if (this->result != versusPlaying && endTime < 0) {
+            endTime = now;
+            static const char* results[]{ "", "won", "lost", "draw", "other player left" };
+            SDL_Log("versus: %s at frame %d, %d rollbacks (%d frames simulated again), %d stalls, %d desyncs",
+                results[this->result], this->frame, this->rollbacks, this->resimulatedFrames, this->stalls, this->desyncs);
+            show();
+        }
+        //autoplay leaves once the other side surely saw the end, players leave with escape
+        if (endTime >= 0 && autoplay != 0 && now - endTime > lingerMS)isRunning = false;
+
+        //datagrams don't wake the loop, so waiting for the other player polls every ms
+        if (local->inputReady == NULL || isStalled)SDL_Delay(1);
+        else local->waitInput((startTime < 0 || endTime >= 0) ? now + frameMS : std::min(startTime + (double)this->frame * frameMS, now + frameMS));
+    }
+    if (local->frames == &this->displayFrames)local->frames = nullptr;
+}
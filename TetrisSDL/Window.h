@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <SDL.h>
+#include "RenderTarget.h"
+
+struct Window {
+    SDL_Window* window = NULL;
+    SDL_Surface* surface = NULL;
+    SDL_Surface* windowIcon = NULL;
+    SDL_Renderer* renderer = NULL;
+    RenderTarget target;
+    int backend = surfaceBackend;
+
+    bool initWindow(const char* windowTitle, int sizeX, int sizeY, SDL_Surface* icon, int backend = surfaceBackend, bool createTarget = true);
+    bool createTarget();
+    void freeTarget();
+    bool closeWindow();
+
+    ~Window() {
+        window = NULL;
+        surface = NULL;
+        windowIcon = NULL;
+        renderer = NULL;
+    }
+};
+
+//createTarget = false leaves the target to the thread that will draw (see RenderThread)
+inline bool Window::initWindow(const char* windowTitle, int sizeX, int sizeY,SDL_Surface *icon, int backend, bool createTarget)
+{
+    bool success = true;
+
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        success = false;
+    }
+    else
+    {
+        this->window = SDL_CreateWindow(windowTitle, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, sizeX, sizeY, SDL_WINDOW_SHOWN);
+        if (this->window == NULL)
+        {
+            success = false;
+        }
+        else
+        {
+            this->backend = backend;
+            if (createTarget)success = this->createTarget();
+            SDL_SetWindowIcon(window, icon);
+            windowIcon = icon;
+        }
+    }
+
+    return success;
+}
+
+//renderers may be bound to the thread that created them, so create, draw and free on the same one
+inline bool Window::createTarget() {
+    if (this->backend == rendererBackend) {
+        int sizeX, sizeY;
+        SDL_GetWindowSize(this->window, &sizeX, &sizeY);
+        //falls back to the software renderer when there is no GPU
+        this->renderer = SDL_CreateRenderer(this->window, -1, SDL_RENDERER_TARGETTEXTURE);
+        return(this->renderer != NULL && this->target.createFromRenderer(this->renderer, this->window, sizeX, sizeY));
+    }
+    bool success = this->target.createFromWindow(this->window);
+    this->surface = this->target.surface;
+    return success;
+}
+
+inline void Window::freeTarget() {
+    this->target.freeTarget();
+    if (this->renderer != NULL)SDL_DestroyRenderer(this->renderer);
+    this->renderer = NULL;
+}
+
+inline bool Window::closeWindow() {
+    this->freeTarget();
+    SDL_FreeSurface(this->surface);
+    SDL_DestroyWindow(this->window);
+
+    if (SDL_GetError() == NULL)return true;
+
+    return false;
+}
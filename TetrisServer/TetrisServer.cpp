@@ -0,0 +1,618 @@
+#include <atomic>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "../TetrisSDL/Arena.h"
+#include "../TetrisSDL/SquareMatrixData.h"
+#include "../TetrisSDL/Map.h"
+#include "../TetrisSDL/Blocks.h"
+#include "../TetrisSDL/Game.h"
+#include "../TetrisSDL/TetrisSetup.h"
+#include "../TetrisSDL/InputEvent.h"
+#include "../TetrisSDL/SpscQueue.h"
+#include "../TetrisSDL/Sockets.h"
+#include "../TetrisSDL/Poller.h"
+
+//Headless authoritative server. Clients connect over TCP and only send the buttons they hold,
+//the server plays every Game with Game::stepFrame on a fixed tick and sends back the score,
+//the acknowledged inputs and game overs. Sessions are sharded over a fixed pool of workers,
+//each with its own Poller, tick and arena; the main thread only accepts connections and deals
+//them out round robin.
+//
+//TetrisServer [--port 7100] [--workers N] [--seconds S]
+//TetrisServer --bots N [--connect HOST:PORT] [--workers N] [--seconds S]
+//  load generator: N bot clients holding random buttons, the same worker layout on the client side
+
+const Uint16 defaultPort = 7100;
+const int tickMS = 16;//same fixed frame as VersusSession, whole ms for Game::stepFrame
+
+//client -> server, little-endian: buttons held from the next tick on
+struct ClientMessage {
+    Uint32 sequence;//sent back in ServerMessage::acked once applied
+    Uint8 buttons;//Buttons
+    Uint8 reserved[3];
+};
+
+enum ServerMessageType {
+    serverWelcome = 1,//session started
+    serverUpdate = 2,//inputs applied or a block locked
+    serverGameOver = 3//score is the final one, the next game starts at once
+};
+
+//server -> client, little-endian
+struct ServerMessage {
+    Uint8 type;//ServerMessageType
+    Uint8 highestPoint;
+    Uint8 reserved[2];
+    Uint32 frame;//ticks since the session started
+    Sint32 score;
+    Uint32 acked;//last ClientMessage::sequence applied
+};
+
+inline void swapClientMessage(ClientMessage& message) {
+    message.sequence = SDL_SwapLE32(message.sequence);
+}
+
+inline void swapServerMessage(ServerMessage& message) {
+    message.frame = SDL_SwapLE32(message.frame);
+    message.score = (Sint32)SDL_SwapLE32((Uint32)message.score);
+    message.acked = SDL_SwapLE32(message.acked);
+}
+
+inline Uint32 nextRandom(Uint32& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+//one client and its game; kept for the next client after this one leaves.
+//Made with new, the Map's color tables are on the heap; its rows and the block forms come from the worker arena.
+struct ServerSession {
+    static const int outboxSize = 16 * sizeof(ServerMessage);
+
+    Map map;
+    Blocks blocks;
+    Game game;
+    SocketHandle socket = invalidSocket;
+    int index = 0;//position in ServerWorker::sessions
+    Uint32 frame = 0;
+    Uint8 buttons = 0;
+    Uint32 sequence = 0;//last ClientMessage received
+    bool isAcked = true;//sequence was sent back
+    int score = 0;//last score sent
+    Uint8 inbox[sizeof(ClientMessage)];//start of a message still on its way
+    int inboxUsed = 0;
+    Uint8 outbox[outboxSize];//messages the socket didn't take yet
+    int outboxUsed = 0;
+
+    ServerSession(SquareMatrixData& nums) :map(20, 10), blocks(map), game(blocks, map, nums) {
+        setupMapSymbols(map);
+        setupBlocks(blocks);
+    }
+};
+
+//Plays the sessions of one shard. Sockets are only read between ticks, so a tick sees the buttons
+//that arrived before it; boards and blocks of the sessions made by this thread come from its own arena.
+class ServerWorker {
+    SDL_Thread* thread = NULL;
+    std::atomic<bool> running{ false };
+    SpscQueue<SocketHandle, 1024> accepted;//sockets dealt out by the main thread
+    Poller poller;
+    Arena arena{ 1 << 20 };
+    std::vector<ServerSession*> sessions, freeSessions;
+    SquareMatrixData* nums;
+    Uint32 randomState;
+
+    static int threadMain(void* data);
+    void startSession(SocketHandle socket);
+    void endSession(ServerSession* session);
+    bool receive(ServerSession* session);
+    bool send(ServerSession* session, Uint8 type);
+    bool flush(ServerSession* session);
+    void tick();
+public:
+    //statistics, taken by the main thread once a second
+    std::atomic<int> sessionsCount{ 0 }, ticks{ 0 }, lateTicks{ 0 }, inputs{ 0 }, updates{ 0 }, gamesOver{ 0 };
+    std::atomic<Uint32> tickMicros{ 0 }, maxTickMicros{ 0 };
+
+    ServerWorker(SquareMatrixData& nums, Uint32 seed) :nums(&nums), randomState(seed | 1) {}
+    bool start();
+    bool post(SocketHandle socket) { return accepted.push(socket); }
+    void stop();
+    void report(const char* name) { arena.report(name); }
+
+    ~ServerWorker() {
+        stop();
+    }
+};
+
+inline bool ServerWorker::start() {
+    if (!this->poller.open())return false;
+    this->running = true;
+    this->thread = SDL_CreateThread(threadMain, "server", this);
+    if (this->thread == NULL) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+//sockets still in the queue or in sessions are closed
+inline void ServerWorker::stop() {
+    if (this->thread != NULL) {
+        this->running = false;
+        SDL_WaitThread(this->thread, NULL);
+        this->thread = NULL;
+    }
+    this->running = false;
+    SocketHandle socket;
+    while (this->accepted.pop(socket))closeSocket(socket);
+    for (ServerSession* session : this->sessions) {
+        closeSocket(session->socket);
+        delete session;
+    }
+    for (ServerSession* session : this->freeSessions)delete session;
+    this->sessions.clear();
+    this->freeSessions.clear();
+    this->poller.close();
+}
+
+inline int ServerWorker::threadMain(void* data) {
+    ServerWorker* self = static_cast<ServerWorker*>(data);
+    sessionArena() = &self->arena;
+
+    PollEvent events[256];
+    double nextTick = inputClockMS();
+    while (self->running) {
+        double now = inputClockMS();
+        if (now < nextTick) {
+            int count = self->poller.wait(events, 256, (int)std::ceil(nextTick - now));
+            for (int k = 0; k < count; k++) {
+                ServerSession* session = static_cast<ServerSession*>(events[k].data);
+                if (session->socket != invalidSocket && !self->receive(session))self->endSession(session);
+            }
+            continue;
+        }
+
+        //more than a few ticks behind (machine overloaded): skip them instead of catching up forever
+        if (now - nextTick >= 4 * tickMS) {
+            self->lateTicks += (int)((now - nextTick) / tickMS);
+            nextTick = now;
+        }
+        else if (now - nextTick >= tickMS)self->lateTicks++;
+        self->tick();
+        nextTick += tickMS;
+    }
+
+    sessionArena() = nullptr;
+    return 0;
+}
+
+inline void ServerWorker::startSession(SocketHandle socket) {
+    ServerSession* session;
+    if (this->freeSessions.empty())session = new ServerSession(*this->nums);
+    else {
+        session = this->freeSessions.back();
+        this->freeSessions.pop_back();
+    }
+    session->socket = socket;
+    session->frame = 0;
+    session->buttons = 0;
+    session->sequence = 0;
+    session->isAcked = true;
+    session->score = 0;
+    session->inboxUsed = 0;
+    session->outboxUsed = 0;
+    session->game.resetGame();
+    session->game.seedRandom(nextRandom(this->randomState));
+
+    if (!this->poller.add(socket, session)) {
+        closeSocket(socket);
+        session->socket = invalidSocket;
+        this->freeSessions.push_back(session);
+        return;
+    }
+    session->index = (int)this->sessions.size();
+    this->sessions.push_back(session);
+    if (!send(session, serverWelcome))endSession(session);
+}
+
+//the last session takes the freed place, so ending stays O(1)
+inline void ServerWorker::endSession(ServerSession* session) {
+    this->poller.remove(session->socket);
+    closeSocket(session->socket);
+    session->socket = invalidSocket;
+
+    ServerSession* last = this->sessions.back();
+    this->sessions[session->index] = last;
+    last->index = session->index;
+    this->sessions.pop_back();
+    this->freeSessions.push_back(session);
+}
+
+//false when the client is gone
+inline bool ServerWorker::receive(ServerSession* session) {
+    Uint8 data[256];
+    int received = receiveSome(session->socket, data, sizeof(data));
+    if (received < 0)return false;
+
+    for (int k = 0; k < received; k++) {
+        session->inbox[session->inboxUsed++] = data[k];
+        if (session->inboxUsed < (int)sizeof(ClientMessage))continue;
+
+        ClientMessage message;
+        memcpy(&message, session->inbox, sizeof(message));
+        swapClientMessage(message);
+        session->buttons = message.buttons;
+        session->sequence = message.sequence;
+        session->isAcked = false;
+        session->inboxUsed = 0;
+        this->inputs++;
+    }
+    return true;
+}
+
+//false when the client is gone or stopped reading
+inline bool ServerWorker::send(ServerSession* session, Uint8 type) {
+    if (session->outboxUsed + (int)sizeof(ServerMessage) > ServerSession::outboxSize)return false;
+
+    ServerMessage message{ type, (Uint8)session->map.highestPoint, { 0, 0 }, session->frame, session->game.getScore(), session->sequence };
+    swapServerMessage(message);
+    memcpy(session->outbox + session->outboxUsed, &message, sizeof(message));
+    session->outboxUsed += sizeof(message);
+    session->isAcked = true;
+    session->score = session->game.getScore();
+    this->updates++;
+    return flush(session);
+}
+
+inline bool ServerWorker::flush(ServerSession* session) {
+    int sent = sendSome(session->socket, session->outbox, session->outboxUsed);
+    if (sent < 0)return false;
+    memmove(session->outbox, session->outbox + sent, session->outboxUsed - sent);
+    session->outboxUsed -= sent;
+    return true;
+}
+
+inline void ServerWorker::tick() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    SocketHandle socket;
+    while (this->accepted.pop(socket))startSession(socket);
+
+    for (size_t k = 0; k < this->sessions.size();) {
+        ServerSession* session = this->sessions[k];
+        Game& game = session->game;
+        game.stepFrame(session->buttons, (double)session->frame * tickMS);
+        session->frame++;
+
+        bool isAlive;
+        if (game.getGameOver()) {
+            isAlive = send(session, serverGameOver);
+            game.resetGame();
+            game.seedRandom(nextRandom(this->randomState));
+            this->gamesOver++;
+        }
+        else if (!session->isAcked || game.getScore() != session->score)isAlive = send(session, serverUpdate);
+        else isAlive = session->outboxUsed == 0 || flush(session);
+
+        //endSession moves the last session to k
+        if (isAlive)k++;
+        else endSession(session);
+    }
+
+    Uint32 micros = (Uint32)((SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency());
+    this->tickMicros += micros;
+    if (micros > this->maxTickMicros)this->maxTickMicros = micros;
+    this->sessionsCount = (int)this->sessions.size();
+    this->ticks++;
+}
+
+//one load generating client
+struct Bot {
+    SocketHandle socket = invalidSocket;
+    int index = 0;//position in BotWorker::bots
+    Uint32 randomState = 1;
+    Uint8 buttons = 0;
+    Uint32 sequence = 0;
+    Uint32 waitingFor = 0;//sequence whose ack is timed, 0 for none
+    double sentAt = 0;
+    Uint8 inbox[sizeof(ServerMessage)];
+    int inboxUsed = 0;
+};
+
+//Bots of one shard: every tick each bot may change the buttons it holds, and times
+//how long the server takes to acknowledge them.
+class BotWorker {
+    SDL_Thread* thread = NULL;
+    std::atomic<bool> running{ false };
+    SpscQueue<SocketHandle, 1024> connected;//sockets dealt out by the main thread
+    Poller poller;
+    std::vector<Bot*> bots;
+    Uint32 randomState;
+
+    static int threadMain(void* data);
+    void endBot(Bot* bot);
+    bool receive(Bot* bot, double now);
+    void tick(double now);
+public:
+    //statistics, taken by the main thread once a second
+    std::atomic<int> botsCount{ 0 }, lostBots{ 0 }, inputs{ 0 }, updates{ 0 }, gamesOver{ 0 };
+    std::atomic<int> latencyCount{ 0 };
+    std::atomic<Uint32> latencyMicros{ 0 }, maxLatencyMicros{ 0 };
+
+    BotWorker(Uint32 seed) :randomState(seed | 1) {}
+    bool start();
+    bool post(SocketHandle socket) { return connected.push(socket); }
+    void stop();
+
+    ~BotWorker() {
+        stop();
+    }
+};
+
+inline bool BotWorker::start() {
+    if (!this->poller.open())return false;
+    this->running = true;
+    this->thread = SDL_CreateThread(threadMain, "bots", this);
+    if (this->thread == NULL) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+inline void BotWorker::stop() {
+    if (this->thread != NULL) {
+        this->running = false;
+        SDL_WaitThread(this->thread, NULL);
+        this->thread = NULL;
+    }
+    this->running = false;
+    SocketHandle socket;
+    while (this->connected.pop(socket))closeSocket(socket);
+    for (Bot* bot : this->bots) {
+        closeSocket(bot->socket);
+        delete bot;
+    }
+    this->bots.clear();
+    this->poller.close();
+}
+
+inline int BotWorker::threadMain(void* data) {
+    BotWorker* self = static_cast<BotWorker*>(data);
+
+    PollEvent events[256];
+    double nextTick = inputClockMS();
+    while (self->running) {
+        double now = inputClockMS();
+        if (now < nextTick) {
+            int count = self->poller.wait(events, 256, (int)std::ceil(nextTick - now));
+            now = inputClockMS();
+            for (int k = 0; k < count; k++) {
+                Bot* bot = static_cast<Bot*>(events[k].data);
+                if (bot->socket != invalidSocket && !self->receive(bot, now))self->endBot(bot);
+            }
+            continue;
+        }
+        if (now - nextTick >= 4 * tickMS)nextTick = now;
+        self->tick(now);
+        nextTick += tickMS;
+    }
+    return 0;
+}
+
+inline void BotWorker::endBot(Bot* bot) {
+    this->poller.remove(bot->socket);
+    closeSocket(bot->socket);
+    Bot* last = this->bots.back();
+    this->bots[bot->index] = last;
+    last->index = bot->index;
+    this->bots.pop_back();
+    delete bot;
+    this->lostBots++;
+}
+
+inline bool BotWorker::receive(Bot* bot, double now) {
+    Uint8 data[256];
+    int received = receiveSome(bot->socket, data, sizeof(data));
+    if (received < 0)return false;
+
+    for (int k = 0; k < received; k++) {
+        bot->inbox[bot->inboxUsed++] = data[k];
+        if (bot->inboxUsed < (int)sizeof(ServerMessage))continue;
+
+        ServerMessage message;
+        memcpy(&message, bot->inbox, sizeof(message));
+        swapServerMessage(message);
+        bot->inboxUsed = 0;
+        this->updates++;
+        if (message.type == serverGameOver)this->gamesOver++;
+        if (bot->waitingFor != 0 && message.acked >= bot->waitingFor) {
+            Uint32 micros = (Uint32)((now - bot->sentAt) * 1000);
+            this->latencyMicros += micros;
+            this->latencyCount++;
+            if (micros > this->maxLatencyMicros)this->maxLatencyMicros = micros;
+            bot->waitingFor = 0;
+        }
+    }
+    return true;
+}
+
+//about every 16th tick (4 times a second) a bot changes its buttons; drops are taps, so games keep moving
+inline void BotWorker::tick(double now) {
+    SocketHandle socket;
+    while (this->connected.pop(socket)) {
+        Bot* bot = new Bot;
+        bot->socket = socket;
+        bot->randomState = nextRandom(this->randomState) | 1;
+        if (!this->poller.add(socket, bot)) {
+            closeSocket(socket);
+            delete bot;
+            continue;
+        }
+        bot->index = (int)this->bots.size();
+        this->bots.push_back(bot);
+    }
+
+    for (size_t k = 0; k < this->bots.size();) {
+        Bot* bot = this->bots[k];
+        Uint32 random = nextRandom(bot->randomState);
+        if (random % 16 != 0) {
+            k++;
+            continue;
+        }
+
+        bot->buttons = (Uint8)((random >> 8) & (buttonLeft | buttonRight | buttonRotate | buttonDown));
+        if ((random >> 16) % 4 == 0)bot->buttons |= buttonDrop;
+        ClientMessage message{ ++bot->sequence, bot->buttons, { 0, 0, 0 } };
+        swapClientMessage(message);
+        if (sendSome(bot->socket, &message, sizeof(message)) != (int)sizeof(message)) {
+            endBot(bot);
+            continue;
+        }
+        if (bot->waitingFor == 0) {
+            bot->waitingFor = bot->sequence;
+            bot->sentAt = now;
+        }
+        this->inputs++;
+        k++;
+    }
+    this->botsCount = (int)this->bots.size();
+}
+
+int runServer(Uint16 port, int workersCount, int seconds) {
+    //empty: sessions are never drawn, so their games lay out no score rects
+    SquareMatrixData renderDataNums(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, false);
+
+    SocketHandle listener = listenTcp(port);
+    Poller acceptor;
+    if (listener == invalidSocket || !acceptor.open() || !acceptor.add(listener, NULL)) {
+        SDL_Log("server: can't listen on port %d", port);
+        closeSocket(listener);
+        return(1);
+    }
+
+    std::vector<ServerWorker*> workers;
+    for (int k = 0; k < workersCount; k++) {
+        workers.push_back(new ServerWorker(renderDataNums, (Uint32)time(NULL) * 2654435761u + k));
+        if (!workers.back()->start()) {
+            SDL_Log("server: can't start worker %d", k);
+            for (ServerWorker* worker : workers)delete worker;
+            closeSocket(listener);
+            return(1);
+        }
+    }
+    SDL_Log("server: port %d, %d workers, %d ms ticks", port, workersCount, tickMS);
+
+    PollEvent events[1];
+    double startTime = inputClockMS(), nextReport = startTime + 1000;
+    for (int next = 0; seconds == 0 || inputClockMS() - startTime < seconds * 1000.0;) {
+        if (acceptor.wait(events, 1, 100) > 0) {
+            for (SocketHandle socket; (socket = acceptTcp(listener)) != invalidSocket; next = (next + 1) % workersCount) {
+                if (!workers[next]->post(socket))closeSocket(socket);
+            }
+        }
+        if (inputClockMS() < nextReport)continue;
+        nextReport += 1000;
+
+        int sessions = 0, ticks = 0, lateTicks = 0, inputs = 0, updates = 0, gamesOver = 0;
+        Uint32 tickMicros = 0, maxTickMicros = 0;
+        for (ServerWorker* worker : workers) {
+            sessions += worker->sessionsCount;
+            ticks += worker->ticks.exchange(0);
+            lateTicks += worker->lateTicks.exchange(0);
+            inputs += worker->inputs.exchange(0);
+            updates += worker->updates.exchange(0);
+            gamesOver += worker->gamesOver.exchange(0);
+            tickMicros += worker->tickMicros.exchange(0);
+            maxTickMicros = std::max(maxTickMicros, worker->maxTickMicros.exchange(0));
+        }
+        SDL_Log("server: %d sessions, %d ticks/s per worker (%d late), tick %.2f ms avg %.2f ms max, %d inputs/s, %d updates/s, %d games over",
+            sessions, ticks / workersCount, lateTicks, (ticks > 0) ? tickMicros / 1000.0 / ticks : 0.0, maxTickMicros / 1000.0, inputs, updates, gamesOver);
+    }
+
+    for (int k = 0; k < workersCount; k++) {
+        workers[k]->stop();
+        workers[k]->report(("server worker " + std::to_string(k) + " arena").c_str());
+        delete workers[k];
+    }
+    closeSocket(listener);
+    return(0);
+}
+
+int runBots(const char* host, Uint16 port, int botsCount, int workersCount, int seconds) {
+    std::vector<BotWorker*> workers;
+    for (int k = 0; k < workersCount; k++) {
+        workers.push_back(new BotWorker((Uint32)time(NULL) * 2246822519u + k));
+        if (!workers.back()->start()) {
+            SDL_Log("bots: can't start worker %d", k);
+            for (BotWorker* worker : workers)delete worker;
+            return(1);
+        }
+    }
+
+    int connected = 0;
+    for (int k = 0; k < botsCount; k++) {
+        SocketHandle socket = connectTcp(host, port);
+        if (socket == invalidSocket)break;
+        if (!workers[k % workersCount]->post(socket)) {
+            closeSocket(socket);
+            SDL_Delay(1);
+            continue;
+        }
+        connected++;
+    }
+    SDL_Log("bots: %d of %d connected to %s:%d", connected, botsCount, host, port);
+
+    double startTime = inputClockMS();
+    while (seconds == 0 || inputClockMS() - startTime < seconds * 1000.0) {
+        SDL_Delay(1000);
+        int bots = 0, lostBots = 0, inputs = 0, updates = 0, gamesOver = 0, latencyCount = 0;
+        Uint32 latencyMicros = 0, maxLatencyMicros = 0;
+        for (BotWorker* worker : workers) {
+            bots += worker->botsCount;
+            lostBots += worker->lostBots.exchange(0);
+            inputs += worker->inputs.exchange(0);
+            updates += worker->updates.exchange(0);
+            gamesOver += worker->gamesOver.exchange(0);
+            latencyCount += worker->latencyCount.exchange(0);
+            latencyMicros += worker->latencyMicros.exchange(0);
+            maxLatencyMicros = std::max(maxLatencyMicros, worker->maxLatencyMicros.exchange(0));
+        }
+        SDL_Log("bots: %d connected (%d lost), %d inputs/s, %d updates/s, %d games over, input to ack %.2f ms avg %.2f ms max",
+            bots, lostBots, inputs, updates, gamesOver, (latencyCount > 0) ? latencyMicros / 1000.0 / latencyCount : 0.0, maxLatencyMicros / 1000.0);
+    }
+
+    for (BotWorker* worker : workers)delete worker;
+    return(0);
+}
+
+int SDL_main(int argc, char* argv[])
+{
+    int port = defaultPort, workersCount = (int)SDL_GetCPUCount(), seconds = 0, botsCount = 0;
+    std::string host = "127.0.0.1";
+    for (int k = 1; k + 1 < argc; k++) {
+        if (std::string(argv[k]) == "--port")port = atoi(argv[++k]);
+        else if (std::string(argv[k]) == "--workers")workersCount = atoi(argv[++k]);
+        else if (std::string(argv[k]) == "--seconds")seconds = atoi(argv[++k]);
+        else if (std::string(argv[k]) == "--bots")botsCount = atoi(argv[++k]);
+        else if (std::string(argv[k]) == "--connect") {
+            std::string address = argv[++k];
+            size_t colon = address.rfind(':');
+            host = address.substr(0, colon);
+            if (colon != std::string::npos)port = atoi(address.c_str() + colon + 1);
+        }
+    }
+    if (workersCount < 1)workersCount = 1;
+
+    if (!startSockets()) {
+        SDL_Log("sockets are not available");
+        return(1);
+    }
+    int result = (botsCount > 0) ? runBots(host.c_str(), (Uint16)port, botsCount, workersCount, seconds) : runServer((Uint16)port, workersCount, seconds);
+    stopSockets();
+    return(result);
+}